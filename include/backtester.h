@@ -1,24 +1,32 @@
 #pragma once
 #include "../include/book/orderbook.h"
+#include "coro_scheduler.h"
+#include "feature_store.h"
 #include "message.h"
+#include "message_store.h"
+#include "portfolio.h"
+#include "result_cache.h"
+#include "sampler.h"
 #include "strategy.h"
+#include "timer_wheel.h"
 #include <memory>
+#include <queue>
 #include <vector>
 
 struct TradingDay {
   std::vector<book_message> messages_;
   std::string date_;
-  std::string start_time_;
-  std::string end_time_;
+  uint64_t start_ns_;
+  uint64_t end_ns_;
   std::string file_;
 };
 
 class Backtester {
 public:
-  Backtester(std::shared_ptr<ConnectionPool> pool,
+  Backtester(LogConfig logging,
              const std::string &instrument_id,
-             const std::vector<book_message> &&messages,
-             const std::vector<book_message> &&train_messages = {});
+             std::shared_ptr<const MessageStore> messages,
+             std::shared_ptr<const MessageStore> train_messages = nullptr);
   ~Backtester();
 
   void create_strategy(size_t strategy_index);
@@ -28,10 +36,36 @@ public:
   void start_backtest();
   void stop_backtest();
   void reset_state();
+  void set_feature_store(std::shared_ptr<const FeatureStore> store);
+  // a finished session is stored under its data hash, strategy, parameters
+  // and version; a later identical run loads it instead of replaying
+  void set_result_cache(std::shared_ptr<const ResultCache> cache);
+  // publish marks and fills to a portfolio; the producer belongs to the
+  // thread that runs this backtester
+  void set_portfolio(PortfolioAggregator::Producer *producer);
+  // tells the portfolio this instrument is done, even after an error
+  void finish_portfolio();
+  // when false the session ends with the position still open and pnl marked
+  // at the closing quotes, so a caller can carry it into the next day
+  void set_flatten_at_close(bool flatten);
+  // the book the day's messages are applied to, instead of an empty one
+  void set_opening_snapshot(std::shared_ptr<const BookSnapshot> snapshot);
+  DayResult day_result() const;
+  const BacktestResult &result() const { return result_; }
+
+  // regular session of the day named by a data file, in utc ns
+  static bool session_window(const std::string &filename, uint64_t &start_ns,
+                             uint64_t &end_ns);
 
 private:
-  void run_backtest();
+  // false when stopped before the session ended
+  bool run_backtest();
   void run_multiday_backtest();
+  ResultKey result_key() const;
+  // the strategy's feature columns for the backtest day, from the store
+  void attach_features();
+  void drain_trades(uint64_t time);
+  void mark(uint64_t time, int32_t bid, int32_t ask);
 
   std::queue<TradingDay> trading_days_;
   TradingDay current_day_;
@@ -39,18 +73,27 @@ private:
   std::unique_ptr<Orderbook> train_book_;
   size_t train_message_index_;
   std::unique_ptr<Strategy> strategy_;
-  std::shared_ptr<ConnectionPool> connection_pool_;
+  LogConfig logging_;
   std::string instrument_id_;
-  Connection *db_connection_;
   bool first_update_;
   size_t current_message_index_;
   std::atomic<bool> running_;
-  std::vector<book_message> messages_;
-  std::vector<book_message> train_messages_;
-  std::string start_time_;
-  std::string end_time_;
-  std::string train_start_time_;
-  std::string train_end_time_;
-
-  static constexpr int UPDATE_INTERVAL = 1000;
+  // the stores keep the shared records alive, the spans are what is replayed
+  std::shared_ptr<const MessageStore> message_store_;
+  std::shared_ptr<const MessageStore> train_store_;
+  std::span<const book_message> messages_;
+  std::span<const book_message> train_messages_;
+  SamplerSet samplers_;
+  std::shared_ptr<const FeatureStore> feature_store_;
+  TimerWheel timers_;
+  CoroScheduler scheduler_{&timers_};
+  uint64_t start_ns_ = 0;
+  uint64_t end_ns_ = UINT64_MAX;
+  uint64_t train_start_ns_ = 0;
+  uint64_t train_end_ns_ = UINT64_MAX;
+  bool flatten_at_close_ = true;
+  std::shared_ptr<const ResultCache> result_cache_;
+  std::shared_ptr<const BookSnapshot> opening_;
+  PortfolioAggregator::Producer *portfolio_ = nullptr;
+  BacktestResult result_;
 };
\ No newline at end of file
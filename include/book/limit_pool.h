@@ -37,6 +37,8 @@ public:
     Limit *l = &node->limit;
     l->price_ = price;
     l->volume_ = 0;
+    l->head_ = nullptr;
+    l->tail_ = nullptr;
     l->side_ = side;
     return l;
   }
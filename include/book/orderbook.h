@@ -5,6 +5,7 @@
 #include "limit_pool.h"
 #include "order.h"
 #include "order_pool.h"
+#include "voi.h"
 #include <algorithm>
 #include <chrono>
 #include <iomanip>
@@ -31,11 +32,10 @@ private:
   std::chrono::system_clock::time_point current_message_time_;
   int32_t bid_delta_ = 0;
   int32_t ask_delta_ = 0;
-  int32_t prev_best_bid_ = 0;
-  int32_t prev_best_ask_ = 0;
-  int32_t prev_best_bid_volume_ = 0;
-  int32_t prev_best_ask_volume_ = 0;
+  VoiState voi_state_;
   int32_t voi_ = 0;
+  size_t bid_levels_ = 0;
+  size_t ask_levels_ = 0;
 
   inline size_t get_bid_idx(int32_t px) const { return MAX_ - px; }
   inline size_t get_ask_idx(int32_t px) const { return px - MIN_; }
@@ -48,12 +48,22 @@ private:
   template <bool Side>
   inline void adjust_bbo();
 
+  template <bool Side>
+  inline void clear_side();
+
 public:
   std::vector<int32_t> mid_prices_;
   std::vector<int32_t> mid_prices_curr_;
   std::vector<int32_t> voi_history_;
   std::vector<int32_t> voi_history_curr_;
   inline Orderbook(int32_t min_px, int32_t max_px);
+  // empties the book for another run. cost follows what the last run
+  // touched: live levels and orders go back to the pools, index pages stay
+  // mapped and the ladders keep their storage
+  inline void clear();
+  // every resting order as an add message, best level first and each level
+  // in queue order; replayed into an empty book they rebuild this one
+  inline void snapshot(std::vector<book_message> &out) const;
   template <bool Side>
   inline Limit *get_or_insert_limit(int32_t price);
   inline void process_msg(const book_message &m);
@@ -70,6 +80,9 @@ public:
   inline int32_t get_best_bid_price() const;
   inline int32_t get_best_ask_price() const;
   inline int32_t get_mid_price() const;
+  inline int32_t get_best_bid_volume() const;
+  inline int32_t get_best_ask_volume() const;
+  inline double get_depth_imbalance(size_t ct = 5) const;
   inline size_t get_best_ask_index() const;
   inline size_t get_best_bid_index() const;
   inline double get_imbalance() const;
@@ -103,9 +116,76 @@ inline Limit *Orderbook::get_or_insert_limit(int32_t price) {
     return limit;
   }
   limit = limit_pool_.acquire(price, Side);
+  ++(Side ? bid_levels_ : ask_levels_);
   return limit;
 }
 
+template <bool Side>
+inline void Orderbook::clear_side() {
+  std::vector<Limit *> &ladder = Side ? bids_ : asks_;
+  size_t &levels = Side ? bid_levels_ : ask_levels_;
+  // every live level sits at or past the best index
+  for (size_t idx = Side ? best_bid_idx_ : best_ask_idx_;
+       levels > 0 && idx < RANGE_; ++idx) {
+    Limit *limit = ladder[idx];
+    if (!limit) {
+      continue;
+    }
+    for (Order *order = limit->head_; order;) {
+      Order *next = order->next_;
+      order_lookup_.erase(order->id_);
+      order_pool_.return_order(order);
+      order = next;
+    }
+    limit_pool_.release(limit);
+    ladder[idx] = nullptr;
+    --levels;
+  }
+}
+
+inline void Orderbook::clear() {
+  clear_side<true>();
+  clear_side<false>();
+  order_lookup_.recycle();
+
+  best_bid_idx_ = static_cast<int32_t>(RANGE_);
+  best_ask_idx_ = static_cast<int32_t>(RANGE_);
+  bid_vol_ = 0;
+  ask_vol_ = 0;
+  sum1_ = 0;
+  sum2_ = 0;
+  vwap_ = 0;
+  imbalance_ = 0;
+  bid_delta_ = 0;
+  ask_delta_ = 0;
+  voi_state_ = VoiState{};
+  voi_ = 0;
+  current_message_time_ = {};
+  mid_prices_.clear();
+  mid_prices_curr_.clear();
+  voi_history_.clear();
+  voi_history_curr_.clear();
+}
+
+inline void Orderbook::snapshot(std::vector<book_message> &out) const {
+  for (const bool side : {true, false}) {
+    const std::vector<Limit *> &ladder = side ? bids_ : asks_;
+    size_t levels = side ? bid_levels_ : ask_levels_;
+    for (size_t idx = side ? best_bid_idx_ : best_ask_idx_;
+         levels > 0 && idx < RANGE_; ++idx) {
+      const Limit *limit = ladder[idx];
+      if (!limit) {
+        continue;
+      }
+      for (const Order *order = limit->head_; order; order = order->next_) {
+        out.emplace_back(order->id_, order->unix_time_, order->size,
+                         order->price_, 'A', side);
+      }
+      --levels;
+    }
+  }
+}
+
 inline void Orderbook::process_msg(const book_message &m) {
   if (m.price_ < 1'000'00 || m.price_ > 8'000'00)
     return;
@@ -221,6 +301,7 @@ inline void Orderbook::cancel_order(uint64_t id, int32_t price,
   }
 
   limit_pool_.release(limit);
+  --(Side ? bid_levels_ : ask_levels_);
   adjust_bbo<Side>();
 }
 
@@ -272,64 +353,20 @@ inline void Orderbook::calculate_vwap(int32_t price, int32_t size) {
 }
 
 inline void Orderbook::calculate_voi() {
-  int32_t bid_voi = 0;
-  int32_t ask_voi = 0;
-  int32_t bid_price = get_best_bid_price();
-  int32_t ask_price = get_best_ask_price();
-  int32_t bid_vol = bids_[best_bid_idx_] ? bids_[best_bid_idx_]->volume_ : 0;
-  int32_t ask_vol = asks_[best_ask_idx_] ? asks_[best_ask_idx_]->volume_ : 0;
-
-  if (bid_price == prev_best_bid_) {
-    bid_voi = bid_vol - prev_best_bid_volume_;
-  } else if (bid_price > prev_best_bid_) {
-    bid_voi = bid_vol;
-  }
-
-  if (ask_price == prev_best_ask_) {
-    ask_voi = ask_vol - prev_best_ask_volume_;
-  } else if (ask_price < prev_best_ask_) {
-    ask_voi = ask_vol;
-  }
-
-  voi_ = bid_voi - ask_voi;
+  voi_ = voi_state_.update(get_best_bid_price(), get_best_ask_price(),
+                           get_best_bid_volume(), get_best_ask_volume());
   voi_history_.push_back(voi_);
-  prev_best_bid_ = bid_price;
-  prev_best_ask_ = ask_price;
-  prev_best_bid_volume_ = bid_vol;
-  prev_best_ask_volume_ = ask_vol;
   std::cout << voi_ << std::endl;
-  std::cout << prev_best_bid_ << std::endl;
-  std::cout << prev_best_ask_ << std::endl;
-  std::cout << prev_best_ask_volume_ << std::endl;
-  std::cout << prev_best_bid_volume_ << std::endl;
+  std::cout << voi_state_.bid_ << std::endl;
+  std::cout << voi_state_.ask_ << std::endl;
+  std::cout << voi_state_.ask_volume_ << std::endl;
+  std::cout << voi_state_.bid_volume_ << std::endl;
 }
 
 inline void Orderbook::calculate_voi_curr() {
-  int32_t bid_voi = 0;
-  int32_t ask_voi = 0;
-  int32_t bid_price = get_best_bid_price();
-  int32_t ask_price = get_best_ask_price();
-  int32_t bid_vol = bids_[best_bid_idx_] ? bids_[best_bid_idx_]->volume_ : 0;
-  int32_t ask_vol = asks_[best_ask_idx_] ? asks_[best_ask_idx_]->volume_ : 0;
-
-  if (bid_price == prev_best_bid_) {
-    bid_voi = bid_vol - prev_best_bid_volume_;
-  } else if (bid_price > prev_best_bid_) {
-    bid_voi = bid_vol;
-  }
-
-  if (ask_price == prev_best_ask_) {
-    ask_voi = ask_vol - prev_best_ask_volume_;
-  } else if (ask_price < prev_best_ask_) {
-    ask_voi = ask_vol;
-  }
-
-  voi_ = bid_voi - ask_voi;
+  voi_ = voi_state_.update(get_best_bid_price(), get_best_ask_price(),
+                           get_best_bid_volume(), get_best_ask_volume());
   voi_history_curr_.push_back(voi_);
-  prev_best_bid_ = bid_price;
-  prev_best_ask_ = ask_price;
-  prev_best_bid_volume_ = bid_vol;
-  prev_best_ask_volume_ = ask_vol;
 }
 
 inline void Orderbook::add_mid_price() {
@@ -410,6 +447,41 @@ inline int32_t Orderbook::get_mid_price() const {
   return ((bid + ask) / 2) / 100;
 }
 
+inline int32_t Orderbook::get_best_bid_volume() const {
+  return (best_bid_idx_ < static_cast<int32_t>(RANGE_) && bids_[best_bid_idx_])
+           ? bids_[best_bid_idx_]->volume_
+           : 0;
+}
+
+inline int32_t Orderbook::get_best_ask_volume() const {
+  return (best_ask_idx_ < static_cast<int32_t>(RANGE_) && asks_[best_ask_idx_])
+           ? asks_[best_ask_idx_]->volume_
+           : 0;
+}
+
+// same window as calculate_vols + calculate_imbalance, without touching the
+// cached bid_vol_/ask_vol_
+inline double Orderbook::get_depth_imbalance(size_t ct) const {
+  int64_t bid_vol = 0;
+  int64_t ask_vol = 0;
+  size_t bid_idx = best_bid_idx_;
+  size_t ask_idx = best_ask_idx_;
+
+  for (size_t i = 0; i < ct && bid_idx < RANGE_ && ask_idx < RANGE_; i++) {
+    if (bids_[bid_idx])
+      bid_vol += bids_[bid_idx]->volume_;
+    if (asks_[ask_idx])
+      ask_vol += asks_[ask_idx]->volume_;
+    ++bid_idx;
+    ++ask_idx;
+  }
+
+  const int64_t total = bid_vol + ask_vol;
+  return total > 0 ? static_cast<double>(bid_vol - ask_vol) /
+                         static_cast<double>(total)
+                   : 0.0;
+}
+
 inline size_t Orderbook::get_best_ask_index() const {
   return best_ask_idx_;
 }
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// volume order imbalance between two looks at the top of book. volume at an
+// unchanged best price counts by how much it changed, a better price counts
+// all of its volume and a worse one none. the book's own voi series and the
+// feature store's voi column both step through this, so they can not drift
+struct VoiState {
+  int32_t bid_ = 0;
+  int32_t ask_ = 0;
+  int32_t bid_volume_ = 0;
+  int32_t ask_volume_ = 0;
+
+  inline int32_t update(int32_t bid, int32_t ask, int32_t bid_volume,
+                        int32_t ask_volume) {
+    int32_t bid_voi = 0;
+    int32_t ask_voi = 0;
+    if (bid == bid_) {
+      bid_voi = bid_volume - bid_volume_;
+    } else if (bid > bid_) {
+      bid_voi = bid_volume;
+    }
+    if (ask == ask_) {
+      ask_voi = ask_volume - ask_volume_;
+    } else if (ask < ask_) {
+      ask_voi = ask_volume;
+    }
+    bid_ = bid;
+    ask_ = ask;
+    bid_volume_ = bid_volume;
+    ask_volume_ = ask_volume;
+    return bid_voi - ask_voi;
+  }
+};
@@ -1,6 +1,6 @@
 #pragma once
 #include "backtester.h"
-#include "connection_pool.h"
+#include "day_parallel.h"
 #include <atomic>
 #include <condition_variable>
 #include <map>
@@ -13,24 +13,25 @@ private:
   struct InstrumentConfig {
     std::string instrument_id;
     std::unique_ptr<Backtester> backtester;
-    std::vector<book_message> messages;
-    std::vector<book_message> train_messages;
-    int32_t pnl{0};
+    int64_t pnl{0};
     std::string backtest_file;
     std::string train_file;
     std::thread thread;
   };
 
-  static std::shared_ptr<ConnectionPool> connection_pool_;
-  static std::once_flag pool_init_flag_;
+  LogConfig logging_;
+  std::shared_ptr<const FeatureStore> feature_store_;
+  std::shared_ptr<const ResultCache> result_cache_;
   std::map<std::string, InstrumentConfig> instruments_;
+  PortfolioResult portfolio_;
   std::atomic<bool> running_{false};
   std::atomic<int> completed_count_{0};
   std::mutex completion_mutex_;
   std::mutex cout_mutex_;
 
 public:
-  explicit ConcurrentBacktester();
+  // every backtester started from here logs to the sinks logging enables
+  explicit ConcurrentBacktester(LogConfig logging = {});
   ~ConcurrentBacktester();
 
   ConcurrentBacktester(const ConcurrentBacktester &) = delete;
@@ -41,6 +42,19 @@ public:
                       std::vector<book_message> &&train_messages = {},
                       const std::string &backtest_file = "",
                       const std::string &train_file = "");
+  // instruments, or repeated runs, over the same day can pass the same stores
+  void add_instrument(const std::string &instrument_id,
+                      std::shared_ptr<const MessageStore> messages,
+                      std::shared_ptr<const MessageStore> train_messages,
+                      const std::string &backtest_file = "",
+                      const std::string &train_file = "");
   void start_backtest(size_t strategy_index);
   void stop_backtest();
+  // combined equity curve and exposure of the last start_backtest
+  const PortfolioResult &portfolio() const { return portfolio_; }
+
+  // every day of one instrument on its own core, sharing this logging
+  // config and feature cache
+  DayParallelResult run_day_parallel(DayParallelConfig config,
+                                     DayParallelBacktester::Loader loader);
 };
\ No newline at end of file
@@ -20,12 +20,18 @@ private:
   size_t initial_size_;
   std::atomic<size_t> current_size_{0};
   std::atomic<bool> shutdown_{false};
+  // every connection of the pool is a socket on this one reactor
+  std::shared_ptr<IoReactor> reactor_;
+  std::atomic<size_t> next_{0};
 
   std::mutex buffer_mutex_;
   std::vector<std::string> log_buffer_;
   static constexpr size_t BATCH_SIZE = 1000;
 
   bool add_connection();
+  // round robin, for fire and forget sends that need no exclusive
+  // connection
+  Connection *next_connection();
 
 public:
   ConnectionPool(const std::string &host, int port,
@@ -0,0 +1,480 @@
+#pragma once
+#include "timer_wheel.h"
+#include <array>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <new>
+#include <utility>
+#include <vector>
+
+// size classed free lists for coroutine frames. frames are carved out of
+// 64KB chunks and recycled per class, so spawning and finishing tasks in
+// steady state never touches the global heap
+class FrameArena {
+  static constexpr std::size_t CLASS_BYTES = 64;
+  static constexpr std::size_t CLASSES = 64;
+  static constexpr std::size_t CHUNK_BYTES = 64 * 1024;
+
+  struct FreeNode {
+    FreeNode *next_;
+  };
+
+  std::array<FreeNode *, CLASSES> free_{};
+  std::vector<std::byte *> chunks_;
+  std::byte *curr_ = nullptr;
+  std::byte *end_ = nullptr;
+
+  static inline thread_local FrameArena *current_ = nullptr;
+
+  void alloc_chunk() {
+    void *mem = std::aligned_alloc(64, CHUNK_BYTES);
+    if (!mem) {
+      throw std::bad_alloc{};
+    }
+    chunks_.push_back(static_cast<std::byte *>(mem));
+    curr_ = static_cast<std::byte *>(mem);
+    end_ = curr_ + CHUNK_BYTES;
+  }
+
+public:
+  FrameArena() = default;
+
+  ~FrameArena() {
+    for (auto c : chunks_) {
+      std::free(c);
+    }
+  }
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  void *allocate(std::size_t bytes) {
+    const std::size_t cls = (bytes + CLASS_BYTES - 1) / CLASS_BYTES;
+    if (cls >= CLASSES) {
+      return ::operator new(bytes);
+    }
+    if (FreeNode *n = free_[cls]) {
+      free_[cls] = n->next_;
+      return n;
+    }
+    const std::size_t size = cls * CLASS_BYTES;
+    if (static_cast<std::size_t>(end_ - curr_) < size) {
+      alloc_chunk();
+    }
+    void *p = curr_;
+    curr_ += size;
+    return p;
+  }
+
+  void deallocate(void *p, std::size_t bytes) {
+    const std::size_t cls = (bytes + CLASS_BYTES - 1) / CLASS_BYTES;
+    if (cls >= CLASSES) {
+      ::operator delete(p);
+      return;
+    }
+    auto *n = static_cast<FreeNode *>(p);
+    n->next_ = free_[cls];
+    free_[cls] = n;
+  }
+
+  static FrameArena *current() { return current_; }
+
+  // frames created while a scope is active come from its arena
+  class Scope {
+    FrameArena *prev_;
+
+  public:
+    explicit Scope(FrameArena &arena) : prev_(current_) { current_ = &arena; }
+    ~Scope() { current_ = prev_; }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+  };
+};
+
+class CoroScheduler;
+class WaiterList;
+
+struct CoroWaiter {
+  CoroWaiter *prev_ = nullptr;
+  CoroWaiter *next_ = nullptr;
+  WaiterList *list_ = nullptr;
+  std::coroutine_handle<> handle_;
+  bool (*check_)(CoroWaiter *) = nullptr;
+  TimerWheel::TimerId timer_ = TimerWheel::INVALID_TIMER;
+  bool timed_out_ = false;
+};
+
+// intrusive fifo of suspended awaiters. nodes live inside coroutine frames
+class WaiterList {
+  CoroWaiter *head_ = nullptr;
+  CoroWaiter *tail_ = nullptr;
+
+public:
+  bool empty() const { return head_ == nullptr; }
+  CoroWaiter *front() const { return head_; }
+
+  void push_back(CoroWaiter *w) {
+    w->list_ = this;
+    w->next_ = nullptr;
+    w->prev_ = tail_;
+    if (tail_) {
+      tail_->next_ = w;
+    } else {
+      head_ = w;
+    }
+    tail_ = w;
+  }
+
+  void remove(CoroWaiter *w) {
+    if (w->prev_) {
+      w->prev_->next_ = w->next_;
+    } else {
+      head_ = w->next_;
+    }
+    if (w->next_) {
+      w->next_->prev_ = w->prev_;
+    } else {
+      tail_ = w->prev_;
+    }
+    w->prev_ = w->next_ = nullptr;
+    w->list_ = nullptr;
+  }
+};
+
+// fire and forget task. the scheduler owns the frame once spawned; frames
+// come from the active FrameArena and are freed when the body returns
+class StrategyTask {
+public:
+  struct promise_type {
+    static constexpr std::size_t HEADER = 16;
+
+    CoroScheduler *scheduler_ = nullptr;
+    promise_type *prev_ = nullptr;
+    promise_type *next_ = nullptr;
+
+    static void *operator new(std::size_t bytes) {
+      FrameArena *arena = FrameArena::current();
+      void *mem = arena ? arena->allocate(bytes + HEADER)
+                        : ::operator new(bytes + HEADER);
+      *static_cast<FrameArena **>(mem) = arena;
+      return static_cast<std::byte *>(mem) + HEADER;
+    }
+
+    static void operator delete(void *p, std::size_t bytes) {
+      void *mem = static_cast<std::byte *>(p) - HEADER;
+      FrameArena *arena = *static_cast<FrameArena **>(mem);
+      if (arena) {
+        arena->deallocate(mem, bytes + HEADER);
+      } else {
+        ::operator delete(mem);
+      }
+    }
+
+    ~promise_type();
+
+    StrategyTask get_return_object() {
+      return StrategyTask{
+          std::coroutine_handle<promise_type>::from_promise(*this)};
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception();
+  };
+
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  StrategyTask(StrategyTask &&other) noexcept
+      : handle_(std::exchange(other.handle_, {})) {}
+  StrategyTask(const StrategyTask &) = delete;
+  StrategyTask &operator=(const StrategyTask &) = delete;
+  StrategyTask &operator=(StrategyTask &&) = delete;
+
+  ~StrategyTask() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  handle_type release() { return std::exchange(handle_, {}); }
+
+private:
+  explicit StrategyTask(handle_type h) : handle_(h) {}
+  handle_type handle_;
+};
+
+class CoroEvent;
+
+// single threaded scheduler resumed from the replay loop. tasks suspend on
+// simulated time (via the backtester's TimerWheel), on book conditions that
+// are re-checked after every message, or on events raised by the strategy
+class CoroScheduler : public TimerHandler {
+  struct WaitAwaiter : CoroWaiter {
+    CoroScheduler *sched_;
+
+    explicit WaitAwaiter(CoroScheduler *sched) : sched_(sched) {}
+    WaitAwaiter(const WaitAwaiter &) = delete;
+    WaitAwaiter &operator=(const WaitAwaiter &) = delete;
+
+    // a frame destroyed mid-wait must not leave itself linked anywhere
+    ~WaitAwaiter() {
+      if (list_) {
+        list_->remove(this);
+      }
+      if (timer_ != TimerWheel::INVALID_TIMER) {
+        sched_->timers_->cancel(timer_);
+      }
+    }
+
+    void arm_timeout(uint64_t timeout_ns) {
+      if (timeout_ns) {
+        timer_ = sched_->timers_->schedule_after(
+            timeout_ns, sched_, reinterpret_cast<uint64_t>(this));
+      }
+    }
+  };
+
+  struct SleepAwaiter : WaitAwaiter {
+    uint64_t delay_ns_;
+
+    SleepAwaiter(CoroScheduler *sched, uint64_t delay_ns)
+        : WaitAwaiter(sched), delay_ns_(delay_ns) {}
+
+    bool await_ready() const noexcept { return delay_ns_ == 0; }
+    void await_suspend(std::coroutine_handle<> h) {
+      handle_ = h;
+      timer_ = sched_->timers_->schedule_after(
+          delay_ns_, sched_, reinterpret_cast<uint64_t>(this));
+    }
+    void await_resume() const noexcept {}
+  };
+
+  template <typename Pred>
+  struct ConditionAwaiter : WaitAwaiter {
+    Pred pred_;
+    uint64_t timeout_ns_;
+
+    ConditionAwaiter(CoroScheduler *sched, Pred pred, uint64_t timeout_ns)
+        : WaitAwaiter(sched), pred_(std::move(pred)), timeout_ns_(timeout_ns) {}
+
+    bool await_ready() { return pred_(); }
+    void await_suspend(std::coroutine_handle<> h) {
+      handle_ = h;
+      check_ = [](CoroWaiter *w) {
+        return static_cast<ConditionAwaiter *>(w)->pred_();
+      };
+      sched_->conditions_.push_back(this);
+      arm_timeout(timeout_ns_);
+    }
+    // false if the timeout expired first
+    bool await_resume() const noexcept { return !timed_out_; }
+  };
+
+  struct NextMessageAwaiter : WaitAwaiter {
+    using WaitAwaiter::WaitAwaiter;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      handle_ = h;
+      sched_->next_message_.push_back(this);
+    }
+    void await_resume() const noexcept {}
+  };
+
+  struct EventAwaiter : WaitAwaiter {
+    CoroEvent &event_;
+    uint64_t timeout_ns_;
+
+    EventAwaiter(CoroScheduler *sched, CoroEvent &event, uint64_t timeout_ns)
+        : WaitAwaiter(sched), event_(event), timeout_ns_(timeout_ns) {}
+
+    inline bool await_ready() const noexcept;
+    inline void await_suspend(std::coroutine_handle<> h);
+    bool await_resume() const noexcept { return !timed_out_; }
+  };
+
+  friend class CoroEvent;
+  friend struct StrategyTask::promise_type;
+
+  TimerWheel *timers_;
+  FrameArena arena_;
+  WaiterList conditions_;
+  WaiterList next_message_;
+  std::vector<std::coroutine_handle<>> ready_;
+  StrategyTask::promise_type *live_ = nullptr;
+  size_t live_count_ = 0;
+  std::exception_ptr error_;
+
+  void resume(std::coroutine_handle<> h) {
+    h.resume();
+    if (error_) {
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+  }
+
+  void make_ready(CoroWaiter *w) {
+    if (w->list_) {
+      w->list_->remove(w);
+    }
+    if (w->timer_ != TimerWheel::INVALID_TIMER) {
+      timers_->cancel(w->timer_);
+      w->timer_ = TimerWheel::INVALID_TIMER;
+    }
+    ready_.push_back(w->handle_);
+  }
+
+  void drain_ready() {
+    // resumed tasks may make further tasks ready
+    for (size_t i = 0; i < ready_.size(); ++i) {
+      resume(ready_[i]);
+    }
+    ready_.clear();
+  }
+
+  void poll() {
+    for (CoroWaiter *w = conditions_.front(); w;) {
+      CoroWaiter *next = w->next_;
+      if (w->check_(w)) {
+        make_ready(w);
+      }
+      w = next;
+    }
+    while (!next_message_.empty()) {
+      make_ready(next_message_.front());
+    }
+    drain_ready();
+  }
+
+  void forget(StrategyTask::promise_type *p) {
+    if (p->prev_) {
+      p->prev_->next_ = p->next_;
+    } else {
+      live_ = p->next_;
+    }
+    if (p->next_) {
+      p->next_->prev_ = p->prev_;
+    }
+    --live_count_;
+  }
+
+public:
+  explicit CoroScheduler(TimerWheel *timers) : timers_(timers) {
+    ready_.reserve(256);
+  }
+
+  ~CoroScheduler() { shutdown(); }
+
+  CoroScheduler(const CoroScheduler &) = delete;
+  CoroScheduler &operator=(const CoroScheduler &) = delete;
+
+  // runs the task until its first suspension point
+  void spawn(StrategyTask task) {
+    auto h = task.release();
+    auto &p = h.promise();
+    p.scheduler_ = this;
+    p.next_ = live_;
+    if (live_) {
+      live_->prev_ = &p;
+    }
+    live_ = &p;
+    ++live_count_;
+    resume(h);
+    drain_ready();
+  }
+
+  // called by the replay loop after each message in the trading window
+  inline void on_message() {
+    if (conditions_.empty() && next_message_.empty() && ready_.empty()) {
+      return;
+    }
+    poll();
+  }
+
+  void on_timer(uint64_t tag) override {
+    auto *w = reinterpret_cast<CoroWaiter *>(tag);
+    w->timer_ = TimerWheel::INVALID_TIMER;
+    w->timed_out_ = true;
+    if (w->list_) {
+      w->list_->remove(w);
+    }
+    resume(w->handle_);
+    drain_ready();
+  }
+
+  SleepAwaiter sleep_for(uint64_t delay_ns) { return {this, delay_ns}; }
+
+  NextMessageAwaiter next_message() { return NextMessageAwaiter{this}; }
+
+  // resumes once pred() holds after some message; with a timeout, co_await
+  // yields false if it expired first
+  template <typename Pred>
+  ConditionAwaiter<Pred> wait_until(Pred pred, uint64_t timeout_ns = 0) {
+    return {this, std::move(pred), timeout_ns};
+  }
+
+  EventAwaiter wait(CoroEvent &event, uint64_t timeout_ns = 0) {
+    return {this, event, timeout_ns};
+  }
+
+  // destroys every suspended task; awaiters unlink themselves on the way
+  void shutdown() {
+    while (live_) {
+      StrategyTask::handle_type::from_promise(*live_).destroy();
+    }
+    ready_.clear();
+  }
+
+  FrameArena &arena() { return arena_; }
+  size_t active() const { return live_count_; }
+};
+
+// latching event, e.g. a fill. set() wakes every waiter and stays set until
+// reset() so a task that awaits after the fact does not block
+class CoroEvent {
+  friend class CoroScheduler;
+
+  CoroScheduler &sched_;
+  WaiterList waiters_;
+  bool set_ = false;
+
+public:
+  explicit CoroEvent(CoroScheduler &sched) : sched_(sched) {}
+
+  void set() {
+    set_ = true;
+    while (!waiters_.empty()) {
+      sched_.make_ready(waiters_.front());
+    }
+  }
+
+  void reset() { set_ = false; }
+  bool is_set() const { return set_; }
+};
+
+inline bool CoroScheduler::EventAwaiter::await_ready() const noexcept {
+  return event_.set_;
+}
+
+inline void
+CoroScheduler::EventAwaiter::await_suspend(std::coroutine_handle<> h) {
+  handle_ = h;
+  event_.waiters_.push_back(this);
+  arm_timeout(timeout_ns_);
+}
+
+inline StrategyTask::promise_type::~promise_type() {
+  if (scheduler_) {
+    scheduler_->forget(this);
+  }
+}
+
+inline void StrategyTask::promise_type::unhandled_exception() {
+  if (scheduler_) {
+    scheduler_->error_ = std::current_exception();
+  } else {
+    std::terminate();
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "backtester.h"
+#include "log_sink.h"
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// how a position still open at one session's close is treated when the
+// independently replayed days are stitched together
+enum class CarryPolicy {
+  // every day closes out at its own close, days are exactly independent
+  FLATTEN,
+  // the position is held overnight and closed at the next day's opening
+  // quote. the next day was still simulated from flat, so its own
+  // decisions do not see the carried position
+  CARRY_TO_OPEN
+};
+
+struct DayParallelConfig {
+  std::string instrument_id_;
+  // one data file per day, in date order
+  std::vector<std::string> files_;
+  size_t strategy_index_ = 0;
+  CarryPolicy carry_ = CarryPolicy::FLATTEN;
+  // fit on the previous file before each day; the first file is then only
+  // used for training
+  bool train_on_previous_day_ = false;
+  // the feed opens every day with a full book, so each day can start from
+  // an empty one. otherwise every day starts from the previous day's
+  // closing book, rebuilt by a book only pass over the days in order
+  bool clean_start_ = false;
+  unsigned threads_ = 0;
+};
+
+struct DayParallelResult {
+  std::vector<DayResult> days_;
+  // per day pnl after the carry policy is applied
+  std::vector<int64_t> day_pnl_;
+  int64_t total_pnl_ = 0;
+};
+
+// replays each trading day of one instrument on its own core. a day starts
+// from its boundary snapshot, the book as a continuous replay of every
+// earlier day leaves it, so it opens in the same state as a serial
+// multi-day run. snapshots saved in the feature store by earlier runs are
+// loaded first; only missing ones are built, by one book only pass that
+// runs ahead of the workers. with clean_start_ days start from an empty
+// book instead
+class DayParallelBacktester {
+public:
+  using Loader = std::function<std::shared_ptr<const MessageStore>(
+      const std::string &file)>;
+
+  DayParallelBacktester(LogConfig logging,
+                        DayParallelConfig config, Loader loader,
+                        std::shared_ptr<const FeatureStore> store = nullptr,
+                        std::shared_ptr<const ResultCache> results = nullptr);
+
+  DayParallelResult run();
+  void stop();
+
+  static DayParallelResult merge(std::vector<DayResult> days,
+                                 CarryPolicy policy);
+
+private:
+  // a day is both tested and, with train_on_previous_day_, the next day's
+  // training set. whichever worker needs it first loads it and the other
+  // shares the store while either still holds it
+  struct CachedDay {
+    std::mutex mutex_;
+    std::weak_ptr<const MessageStore> store_;
+  };
+
+  DayResult run_day(size_t day);
+  std::shared_ptr<const MessageStore> load(size_t day);
+  // publishes the opening snapshot of every day after the first: all the
+  // saved ones, then the missing ones in day order as one book catches up
+  // to them
+  void build_snapshots(size_t days);
+
+  LogConfig logging_;
+  DayParallelConfig config_;
+  Loader loader_;
+  std::shared_ptr<const FeatureStore> store_;
+  std::shared_ptr<const ResultCache> results_;
+  std::unique_ptr<CachedDay[]> cache_;
+  // opening snapshot of each day, null for an empty book
+  std::unique_ptr<std::promise<std::shared_ptr<const BookSnapshot>>[]>
+      openings_;
+  std::atomic<bool> running_{false};
+};
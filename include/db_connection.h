@@ -1,12 +1,8 @@
 #pragma once
-#include "lock_free_queue.h"
+#include "io_reactor.h"
 #include <atomic>
 #include <memory>
-#include <mutex>
-#include <netinet/in.h>
 #include <string>
-#include <sys/socket.h>
-#include <thread>
 #include <utility>
 #include <vector>
 
@@ -17,31 +13,36 @@ struct OrderBookUpdate
     uint64_t timestamp_;
 };
 
+// one database socket, owned and driven by an IoReactor. sends never block
+// and never touch the socket; a connection only names its reactor endpoint
 class Connection
 {
 private:
-    int sock_{-1};
-    struct sockaddr_in serv_addr_{};
+    std::shared_ptr<IoReactor> reactor_;
+    uint32_t endpoint_;
     std::string connection_id_;
-    std::atomic<bool> active_{false};
     std::atomic<bool> in_use_{false};
-    std::unique_ptr<LockFreeQueue<std::string, 1000000>> trade_log_queue_;
-    std::thread trade_log_thread_;
-    std::atomic<bool> stop_thread_{false};
-    std::mutex conn_mutex_;
-    void process_database_queue();
-    bool ensure_connected();
-    bool connect();
-    void reconnect();
 
 public:
-    Connection(const std::string& host, int port, const std::string& id);
-    ~Connection();
+    // without a reactor the connection uses the process wide one
+    Connection(const std::string& host, int port, const std::string& id,
+               std::shared_ptr<IoReactor> reactor = nullptr);
     Connection(const Connection&) = delete;
     Connection& operator=(const Connection&) = delete;
 
-    void send_trade_log(const std::string& log_entry);
-    bool is_active() const { return active_; }
+    // false when the calling thread's queue to the reactor is full; a
+    // rejected batch is left in lines
+    bool send_trade_log(const std::string& log_entry);
+    // a buffer of complete lines; queued buffers go out together in one
+    // gathered write
+    bool send_batch(std::string&& lines);
+    // a previously sent batch buffer to encode the next batch into, or an
+    // empty string when none has come back yet
+    std::string spare_buffer();
+    uint64_t bytes_sent() const { return reactor_->bytes_sent(endpoint_); }
+    uint64_t writes() const { return reactor_->writes(endpoint_); }
+
+    bool is_active() const { return reactor_->connected(endpoint_); }
     bool is_in_use() const { return in_use_; }
     void set_in_use(bool value) { in_use_ = value; }
     const std::string& get_id() const { return connection_id_; }
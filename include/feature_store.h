@@ -0,0 +1,160 @@
+#pragma once
+#include "book/orderbook.h"
+#include "message.h"
+#include "sampler.h"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+enum class Feature : uint8_t {
+  TIME,
+  VOI,
+  MID,
+  BID,
+  ASK,
+  MICROPRICE,
+  IMBALANCE,
+  SPREAD,
+  COUNT
+};
+
+constexpr uint32_t feature_bit(Feature f) {
+  return 1u << static_cast<uint8_t>(f);
+}
+
+constexpr uint32_t ALL_FEATURES =
+    (1u << static_cast<uint8_t>(Feature::COUNT)) - 1;
+
+// what to extract and on which cadence. the tag names the sampler in the
+// cache key, so two specs with the same tag must build the same sampler
+struct FeatureSpec {
+  std::string sampler_tag_;
+  std::function<std::unique_ptr<Sampler>()> make_sampler_;
+  uint32_t columns_ = ALL_FEATURES;
+  size_t depth_ = 5;
+
+  static FeatureSpec time_bars(uint64_t interval_ns,
+                               uint32_t columns = ALL_FEATURES);
+};
+
+// read-only column block for one (day, sampler). columns are either mapped
+// straight from the cache files or, if the cache could not be written, held
+// in memory; callers only ever see spans
+class FeatureFrame {
+public:
+  struct Column {
+    const std::byte *data_ = nullptr;
+    size_t rows_ = 0;
+    std::shared_ptr<const void> owner_;
+  };
+
+  FeatureFrame() = default;
+
+  size_t rows() const { return rows_; }
+  bool has(Feature f) const { return columns_[index(f)].data_ != nullptr; }
+
+  std::span<const uint64_t> time() const { return get<uint64_t>(Feature::TIME); }
+  std::span<const int32_t> voi() const { return get<int32_t>(Feature::VOI); }
+  std::span<const int32_t> mid() const { return get<int32_t>(Feature::MID); }
+  std::span<const int32_t> bid() const { return get<int32_t>(Feature::BID); }
+  std::span<const int32_t> ask() const { return get<int32_t>(Feature::ASK); }
+  std::span<const double> microprice() const {
+    return get<double>(Feature::MICROPRICE);
+  }
+  std::span<const double> imbalance() const {
+    return get<double>(Feature::IMBALANCE);
+  }
+  std::span<const int32_t> spread() const {
+    return get<int32_t>(Feature::SPREAD);
+  }
+
+private:
+  friend class FeatureStore;
+
+  static size_t index(Feature f) { return static_cast<size_t>(f); }
+
+  template <typename T>
+  std::span<const T> get(Feature f) const {
+    const Column &c = columns_[index(f)];
+    return {reinterpret_cast<const T *>(c.data_), c.data_ ? c.rows_ : 0};
+  }
+
+  std::array<Column, static_cast<size_t>(Feature::COUNT)> columns_{};
+  size_t rows_ = 0;
+};
+
+// resting orders of a book at a day boundary, as add messages; replayed into
+// an empty book they rebuild it exactly
+struct BookSnapshot {
+  std::vector<book_message> orders_;
+  // FeatureStore::snapshot_key of the boundary, part of the result cache key
+  uint64_t hash_ = 0;
+};
+
+// extracts feature columns once per (data hash, sampler, session window) and
+// keeps them as flat column files:
+//   <root>/<data hash>/<sampler tag>_d<depth>_v<version>_<start>_<end>/
+//   <column>.col
+// later runs over the same day map the files instead of replaying the book.
+// books at day boundaries are kept the same way, as
+//   <root>/snapshots/<key>_v<version>.book
+// so a multi-day run only replays the days whose closing book is missing
+class FeatureStore {
+public:
+  // bump whenever extract() changes what a column holds, so frames written
+  // by an older extractor are never read again
+  static constexpr uint32_t EXTRACTOR_VERSION = 1;
+  // bump whenever the book changes which orders it keeps
+  static constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+  explicit FeatureStore(std::filesystem::path root = "feature_cache");
+
+  // xxh3 over the message fields, independent of struct padding
+  static uint64_t hash_messages(std::span<const book_message> messages);
+
+  std::optional<FeatureFrame> open(uint64_t data_hash, uint64_t start_ns,
+                                   uint64_t end_ns,
+                                   const FeatureSpec &spec) const;
+
+  // replays messages through scratch_book (which must be empty) and samples
+  // rows for messages in [start_ns, end_ns]
+  FeatureFrame extract(std::span<const book_message> messages,
+                       uint64_t start_ns, uint64_t end_ns,
+                       const FeatureSpec &spec, Orderbook &scratch_book) const;
+
+  FeatureFrame load_or_extract(std::span<const book_message> messages,
+                               uint64_t start_ns, uint64_t end_ns,
+                               const FeatureSpec &spec,
+                               Orderbook &scratch_book) const;
+  // for callers that already hold hash_messages(messages), such as a
+  // MessageStore
+  FeatureFrame load_or_extract(uint64_t data_hash,
+                               std::span<const book_message> messages,
+                               uint64_t start_ns, uint64_t end_ns,
+                               const FeatureSpec &spec,
+                               Orderbook &scratch_book) const;
+
+  // the book a day opens with is the book the previous day opened with plus
+  // the previous day's messages, so it is named by those two. 0 is the
+  // empty book the first day opens with
+  static uint64_t snapshot_key(uint64_t prev_data_hash, uint64_t prev_key);
+
+  // null if the snapshot was never saved or can not be read
+  std::shared_ptr<const BookSnapshot> open_snapshot(uint64_t key) const;
+  // under snapshot.hash_
+  void save_snapshot(const BookSnapshot &snapshot) const;
+
+private:
+  std::filesystem::path snapshot_path(uint64_t key) const;
+  std::filesystem::path frame_dir(uint64_t data_hash, uint64_t start_ns,
+                                  uint64_t end_ns,
+                                  const FeatureSpec &spec) const;
+
+  std::filesystem::path root_;
+};
@@ -0,0 +1,128 @@
+#pragma once
+#include "lane_set.h"
+#include "lock_free_queue.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// one thread owning every outgoing socket of the process. sockets are non
+// blocking and driven by epoll: connects complete asynchronously, a failed
+// or dropped connection is retried with exponential backoff, and short
+// writes resume where they stopped. producers hand whole buffers to the
+// reactor through per thread lanes and never touch a socket
+class IoReactor {
+public:
+  static constexpr size_t LANE_CAPACITY = 1 << 16;
+  // per endpoint bytes held while it is unreachable; newer buffers are
+  // dropped past this
+  static constexpr size_t MAX_PENDING_BYTES = 64 * 1024 * 1024;
+  static constexpr std::chrono::milliseconds INITIAL_BACKOFF{50};
+  static constexpr std::chrono::milliseconds MAX_BACKOFF{5000};
+  // how long the destructor keeps trying to deliver what is queued
+  static constexpr std::chrono::milliseconds SHUTDOWN_GRACE{2000};
+
+  IoReactor();
+  ~IoReactor();
+
+  IoReactor(const IoReactor &) = delete;
+  IoReactor &operator=(const IoReactor &) = delete;
+
+  // shared by connections created without a reactor of their own
+  static std::shared_ptr<IoReactor> shared();
+
+  // a destination; nothing is connected until there is data for it
+  uint32_t add_endpoint(const std::string &host, int port,
+                        const std::string &id);
+
+  // queues complete lines for the endpoint. false if the calling thread's
+  // lane is full, and bytes are left with the caller
+  __attribute__((always_inline))
+  bool send(uint32_t endpoint, std::string &&bytes) {
+    Submission submission{endpoint, std::move(bytes)};
+    if (!lanes_.local().try_push(std::move(submission))) {
+      bytes = std::move(submission.bytes_);
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    // pairs with the fence before epoll_wait, so the reactor either sees
+    // the submission or is seen sleeping and woken
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) &&
+        sleeping_.exchange(false, std::memory_order_relaxed)) {
+      wake();
+    }
+    return true;
+  }
+
+  // a buffer the endpoint has finished sending, to fill again
+  std::string spare_buffer(uint32_t endpoint);
+
+  bool connected(uint32_t endpoint) const;
+  uint64_t bytes_sent(uint32_t endpoint) const;
+  uint64_t writes(uint32_t endpoint) const;
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+  struct Submission {
+    uint32_t endpoint_ = 0;
+    std::string bytes_;
+  };
+
+  enum class State { IDLE, CONNECTING, CONNECTED, BACKOFF };
+
+  struct Endpoint {
+    uint32_t index_ = 0;
+    std::string id_;
+    sockaddr_in addr_{};
+    // reactor thread only
+    int fd_ = -1;
+    State state_ = State::IDLE;
+    std::deque<std::string> out_;
+    size_t out_bytes_ = 0;
+    // bytes of out_.front() already written
+    size_t offset_ = 0;
+    bool want_write_ = false;
+    std::chrono::milliseconds backoff_ = INITIAL_BACKOFF;
+    std::chrono::steady_clock::time_point retry_at_;
+    // read from any thread
+    std::atomic<bool> connected_{false};
+    std::atomic<uint64_t> bytes_sent_{0};
+    std::atomic<uint64_t> writes_{0};
+    LockFreeQueue<std::string, 64> spares_;
+  };
+
+  void wake();
+  void run();
+  bool drain_lanes();
+  void start_connect(Endpoint &endpoint);
+  void on_connected(Endpoint &endpoint);
+  void fail(Endpoint &endpoint, const char *what, int error);
+  void flush(Endpoint &endpoint);
+  void update_interest(Endpoint &endpoint, bool want_write);
+  bool idle() const;
+  int next_timeout_ms() const;
+
+  LaneSet<Submission> lanes_{LANE_CAPACITY};
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+  std::atomic<bool> sleeping_{false};
+  std::atomic<bool> running_{true};
+  std::atomic<uint64_t> dropped_{0};
+
+  // endpoints are only added, under mutex_, and published through
+  // endpoint_count_
+  static constexpr size_t MAX_ENDPOINTS = 256;
+  std::mutex mutex_;
+  std::array<std::unique_ptr<Endpoint>, MAX_ENDPOINTS> endpoints_{};
+  std::atomic<uint32_t> endpoint_count_{0};
+
+  std::thread thread_;
+};
@@ -0,0 +1,120 @@
+#pragma once
+#include "spsc_ring.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// per thread spsc lanes feeding one consumer. a thread gets a lane of a set
+// the first time it calls local() and gives it back when it exits; the next
+// thread that needs one takes it over, items still queued included, so the
+// number of lanes follows the peak number of producing threads. the
+// releasing thread's last push happens before the new owner's claim, so a
+// lane never has two producers at once
+template <typename T>
+class LaneSet {
+public:
+  static constexpr size_t MAX_LANES = 256;
+
+  explicit LaneSet(size_t lane_capacity)
+      : lane_capacity_(lane_capacity), id_(next_id_.fetch_add(1)) {}
+
+  LaneSet(const LaneSet &) = delete;
+  LaneSet &operator=(const LaneSet &) = delete;
+
+  // producer side: the calling thread's lane
+  __attribute__((always_inline))
+  SpscRing<T> &local() {
+    if (__builtin_expect(last_set_ == id_, 1)) {
+      return *last_ring_;
+    }
+    return claim();
+  }
+
+  // consumer side: lanes [0, size()) are valid
+  size_t size() const { return count_.load(std::memory_order_acquire); }
+  SpscRing<T> &lane(size_t i) { return lanes_[i]->ring_; }
+
+  bool pending() const {
+    const size_t count = size();
+    for (size_t i = 0; i < count; ++i) {
+      if (!lanes_[i]->ring_.empty()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+private:
+  struct Lane {
+    explicit Lane(size_t capacity) : ring_(capacity) {}
+    SpscRing<T> ring_;
+    std::atomic<bool> owned_{false};
+  };
+
+  // every lane the thread holds, of any set of this element type. shared so
+  // a set destroyed before the thread exits leaves nothing dangling
+  struct Held {
+    std::vector<std::pair<uint64_t, std::shared_ptr<Lane>>> lanes_;
+    ~Held() {
+      for (auto &[set, lane] : lanes_) {
+        lane->owned_.store(false, std::memory_order_release);
+      }
+    }
+  };
+
+  SpscRing<T> &claim() {
+    auto &held = held_;
+    for (auto &[set, lane] : held.lanes_) {
+      if (set == id_) {
+        return remember(*lane);
+      }
+    }
+
+    std::shared_ptr<Lane> lane;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const size_t count = count_.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < count && !lane; ++i) {
+        if (!lanes_[i]->owned_.load(std::memory_order_acquire)) {
+          lane = lanes_[i];
+        }
+      }
+      if (!lane) {
+        if (count == MAX_LANES) {
+          throw std::runtime_error("too many producer threads for lane set");
+        }
+        lane = std::make_shared<Lane>(lane_capacity_);
+        lanes_[count] = lane;
+        count_.store(count + 1, std::memory_order_release);
+      }
+      lane->owned_.store(true, std::memory_order_relaxed);
+    }
+    held.lanes_.emplace_back(id_, lane);
+    return remember(*lane);
+  }
+
+  SpscRing<T> &remember(Lane &lane) {
+    last_set_ = id_;
+    last_ring_ = &lane.ring_;
+    return lane.ring_;
+  }
+
+  static inline std::atomic<uint64_t> next_id_{1};
+  // the thread's most recently used lane; trivially destructible so the hot
+  // path is two plain thread local loads
+  static inline thread_local uint64_t last_set_ = 0;
+  static inline thread_local SpscRing<T> *last_ring_ = nullptr;
+  static inline thread_local Held held_;
+
+  const size_t lane_capacity_;
+  const uint64_t id_;
+  std::mutex mutex_;
+  // slots are written once, before count_ is published
+  std::array<std::shared_ptr<Lane>, MAX_LANES> lanes_{};
+  std::atomic<size_t> count_{0};
+};
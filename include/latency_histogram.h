@@ -0,0 +1,96 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// log linear histogram in the style of hdr histogram. values below
+// 2 * SUB_BUCKETS are counted exactly; above that every power of two is
+// split into SUB_BUCKETS equal buckets, so a value is known to within
+// 1 / SUB_BUCKETS of itself. recording is a bit scan, a shift and an
+// increment, with no branches on the value's magnitude past the first
+class LatencyHistogram {
+public:
+  static constexpr unsigned SUB_BUCKET_BITS = 5;
+  static constexpr uint64_t SUB_BUCKETS = uint64_t{1} << SUB_BUCKET_BITS;
+  // larger values are counted in the last bucket; max() stays exact
+  static constexpr unsigned MAX_BITS = 40;
+  static constexpr uint64_t MAX_VALUE = (uint64_t{1} << MAX_BITS) - 1;
+  static constexpr size_t BUCKETS =
+      (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  __attribute__((always_inline))
+  void record(uint64_t value) {
+    ++counts_[index(std::min(value, MAX_VALUE))];
+    ++total_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+
+  void merge(const LatencyHistogram &other) {
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      counts_[i] += other.counts_[i];
+    }
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+  void clear() { *this = LatencyHistogram{}; }
+
+  uint64_t count() const { return total_; }
+  uint64_t min() const { return total_ ? min_ : 0; }
+  uint64_t max() const { return max_; }
+
+  // the highest value of the bucket holding the q-th quantile, q in [0, 1]
+  uint64_t value_at(double q) const {
+    if (total_ == 0) {
+      return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(total_))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+      seen += counts_[i];
+      if (seen >= rank) {
+        return std::min(highest(i), max_);
+      }
+    }
+    return max_;
+  }
+
+  uint64_t count_at(size_t bucket) const { return counts_[bucket]; }
+
+  static size_t index(uint64_t value) {
+    if (value < 2 * SUB_BUCKETS) {
+      return static_cast<size_t>(value);
+    }
+    const unsigned shift =
+        static_cast<unsigned>(std::bit_width(value)) - 1 - SUB_BUCKET_BITS;
+    return shift * SUB_BUCKETS + (value >> shift);
+  }
+
+  // range of values counted in a bucket
+  static uint64_t lowest(size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+      return bucket;
+    }
+    const unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+    return (bucket - shift * SUB_BUCKETS) << shift;
+  }
+  static uint64_t highest(size_t bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+      return bucket;
+    }
+    const unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+    return ((bucket - shift * SUB_BUCKETS + 1) << shift) - 1;
+  }
+
+private:
+  std::array<uint64_t, BUCKETS> counts_{};
+  uint64_t total_ = 0;
+  uint64_t min_ = UINT64_MAX;
+  uint64_t max_ = 0;
+};
@@ -0,0 +1,65 @@
+#pragma once
+#include "log_record.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// accumulates influx line protocol for LogRecords in one large buffer. lines
+// are encoded straight from the binary record, and a full or old enough
+// batch is handed to the connection as a whole with take(), which swaps in a
+// recycled buffer so steady state logging does not allocate
+class LineProtocolBatch {
+public:
+  // longest trading_log line for an instrument id of up to 32 characters
+  static constexpr size_t MAX_LINE = 192;
+  static constexpr size_t MAX_INSTRUMENT = 32;
+  static constexpr size_t DEFAULT_FLUSH_BYTES = 256 * 1024;
+  static constexpr std::chrono::milliseconds DEFAULT_FLUSH_INTERVAL{50};
+
+  explicit LineProtocolBatch(
+      size_t flush_bytes = DEFAULT_FLUSH_BYTES,
+      std::chrono::nanoseconds flush_interval = DEFAULT_FLUSH_INTERVAL);
+
+  // trading_log_<instrument> bid=..i,ask=..i,position=..i,trade_count=..i,
+  // pnl=..i <time_ns>\n; returns the bytes written to out
+  static size_t encode(char *out, std::string_view instrument,
+                       const LogRecord &record);
+
+  // a caller that takes the batch once it is full() never grows the buffer;
+  // one that checks less often only costs an allocation
+  void append(std::string_view instrument, const LogRecord &record) {
+    if (used_ == 0) {
+      first_append_ = std::chrono::steady_clock::now();
+    }
+    if (buffer_.size() - used_ < MAX_LINE) {
+      buffer_.resize(used_ + flush_bytes_ + MAX_LINE);
+    }
+    used_ += encode(buffer_.data() + used_, instrument, record);
+  }
+
+  // past the size threshold
+  bool full() const { return used_ >= flush_bytes_; }
+
+  // full, or holding lines older than the interval
+  bool due() const {
+    return full() ||
+           (used_ > 0 &&
+            std::chrono::steady_clock::now() - first_append_ >= flush_interval_);
+  }
+
+  bool empty() const { return used_ == 0; }
+  size_t size() const { return used_; }
+
+  // the encoded lines; spare becomes the next buffer
+  std::string take(std::string spare = {});
+
+private:
+  size_t flush_bytes_;
+  std::chrono::nanoseconds flush_interval_;
+  // sized to flush_bytes_ + MAX_LINE, so until the batch is full() there is
+  // always room for another line
+  std::string buffer_;
+  size_t used_ = 0;
+  std::chrono::steady_clock::time_point first_append_;
+};
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+
+// one trade or state change, fixed size and trivially copyable so the
+// strategy thread only fills 40 bytes and enqueues them. all text is
+// produced by the logger thread
+struct LogRecord {
+  uint64_t time_ns_;
+  int64_t pnl_;
+  int32_t bid_;
+  int32_t ask_;
+  int32_t position_;
+  int32_t trade_count_;
+  // LogService stream the record is routed by; the stream names the
+  // instrument
+  uint32_t stream_;
+  uint32_t reserved_ = 0;
+};
+static_assert(sizeof(LogRecord) == 40);
@@ -0,0 +1,95 @@
+#pragma once
+#include "lane_set.h"
+#include "log_record.h"
+#include "log_sink.h"
+#include "wait_strategy.h"
+#include <array>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// the one logging thread of the process. every thread that logs gets its own
+// spsc lane on first use; the consumer drains all lanes in batches and hands
+// each record to the sinks of its stream. neither threads nor lanes grow with
+// the number of strategies run
+class LogService {
+public:
+  static constexpr size_t MAX_STREAMS = 4096;
+  static constexpr size_t LANE_CAPACITY = 1 << 16;
+
+  static LogService &instance();
+
+  LogService(const LogService &) = delete;
+  LogService &operator=(const LogService &) = delete;
+
+  // a stream is a (log file, instrument, config) triple. sinks are shared
+  // between the streams that name the same file or database, and reopening
+  // a triple returns the same id
+  uint32_t open_stream(const std::string &log_file,
+                       const std::string &instrument_id,
+                       const LogConfig &config);
+
+  // how the consumer waits for records. SPIN_PARK, the default, sleeps while
+  // every lane is empty; BUSY_SPIN keeps a core and picks records up without
+  // a wake. the consumer starts with the first stream, after which the mode
+  // is fixed
+  void set_wait_mode(WaitMode mode);
+  WaitMode wait_mode() const { return wait_.mode(); }
+
+  // cpu < 0 lets the consumer run anywhere
+  void pin_consumer(int cpu);
+
+  __attribute__((always_inline))
+  void log(const LogRecord &record) {
+    if (!lanes_.local().try_push(record)) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    wait_.notify();
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+  size_t lanes() const { return lanes_.size(); }
+
+private:
+  struct Stream {
+    std::string instrument_id_;
+    std::vector<LogSink *> sinks_;
+  };
+
+  LogService();
+  ~LogService();
+
+  // under mutex_
+  void start_consumer();
+  void apply_pin();
+  void consumer_loop();
+
+  // the sink registered under key, created on first use
+  template <typename Sink, typename... Args>
+  LogSink *sink(const std::string &key, Args &&...args);
+
+  // registration side, under mutex_
+  std::mutex mutex_;
+  std::map<std::string, std::unique_ptr<LogSink>> sinks_;
+  std::vector<std::shared_ptr<MemorySink>> memory_sinks_;
+  std::map<std::string, uint32_t> stream_ids_;
+  uint32_t stream_count_ = 0;
+  // INT_MIN until pin_consumer is called
+  int pin_cpu_ = INT_MIN;
+
+  LaneSet<LogRecord> lanes_{LANE_CAPACITY};
+  // read by the consumer; a stream is written before its id is handed out
+  std::unique_ptr<Stream[]> streams_;
+
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool> running_{true};
+  WaitStrategy wait_;
+  std::thread consumer_thread_;
+};
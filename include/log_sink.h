@@ -0,0 +1,126 @@
+#pragma once
+#include "db_connection.h"
+#include "line_protocol.h"
+#include "log_record.h"
+#include "mmap_writer.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// where the records of a LogService stream end up. sinks are written and
+// flushed only by the logging thread
+class LogSink {
+public:
+  virtual ~LogSink() = default;
+  virtual void write(const LogRecord &record, std::string_view instrument) = 0;
+  // called after every batch of records and whenever the logger goes idle
+  virtual void flush() {}
+  virtual void close() {}
+};
+
+// coloured one line summary per record on stdout
+class ConsoleSink : public LogSink {
+public:
+  void write(const LogRecord &record, std::string_view instrument) override;
+  void flush() override;
+};
+
+class CsvSink : public LogSink {
+public:
+  explicit CsvSink(const std::string &path);
+  void write(const LogRecord &record, std::string_view instrument) override;
+  void flush() override { writer_.flush(); }
+  void close() override { writer_.close(); }
+
+private:
+  SegmentedMmapWriter writer_;
+};
+
+// the records as they are in memory, after an 8 byte magic. nothing is
+// formatted and the instrument is not in the record, so a file holds one
+// instrument
+class BinarySink : public LogSink {
+public:
+  static constexpr std::string_view MAGIC{"HFTLOG1\n"};
+
+  explicit BinarySink(const std::string &path);
+  void write(const LogRecord &record, std::string_view) override {
+    writer_.write(reinterpret_cast<const char *>(&record), sizeof(record));
+  }
+  void flush() override { writer_.flush(); }
+  void close() override { writer_.close(); }
+
+private:
+  SegmentedMmapWriter writer_;
+};
+
+// influx line protocol to a database. the connection is only made once
+// there is something to send, and an unreachable database costs the backtest
+// nothing but the encoding
+class LineProtocolSink : public LogSink {
+public:
+  LineProtocolSink(const std::string &host, int port);
+  void write(const LogRecord &record, std::string_view instrument) override {
+    batch_.append(instrument, record);
+    if (batch_.full()) {
+      flush();
+    }
+  }
+  void flush() override;
+
+  const Connection &connection() const { return connection_; }
+
+private:
+  Connection connection_;
+  LineProtocolBatch batch_;
+};
+
+// the newest capacity records, for a caller that wants a run's trades
+// without files or a database. snapshot() may be called from any thread
+class MemorySink : public LogSink {
+public:
+  explicit MemorySink(size_t capacity = 1 << 16);
+  void write(const LogRecord &record, std::string_view) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    records_[written_++ % records_.size()] = record;
+  }
+
+  // oldest first
+  std::vector<LogRecord> snapshot() const;
+  // every record ever written, including those overwritten since
+  uint64_t written() const;
+
+private:
+  mutable std::mutex mutex_;
+  std::vector<LogRecord> records_;
+  uint64_t written_ = 0;
+};
+
+// the sinks a run logs to. a run with none enabled is offline: loggers are
+// never registered, and logging a trade is one predictable branch
+struct LogConfig {
+  bool console_ = true;
+  bool csv_ = true;
+  // <log file stem>_<instrument>.bin next to the csv file
+  bool binary_ = false;
+  bool database_ = true;
+  std::string db_host_ = "127.0.0.1";
+  int db_port_ = 9009;
+  std::shared_ptr<MemorySink> memory_;
+
+  // nothing is formatted, written or sent
+  static LogConfig offline() {
+    LogConfig config;
+    config.console_ = false;
+    config.csv_ = false;
+    config.database_ = false;
+    return config;
+  }
+
+  bool enabled() const {
+    return console_ || csv_ || binary_ || database_ || memory_;
+  }
+};
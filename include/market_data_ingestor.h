@@ -1,17 +1,26 @@
 #pragma once
 #include <vector>
 #include <memory>
+#include <array>
 #include <atomic>
 #include <thread>
 #include <cstdint>
 #include <cstddef>
+#include <ostream>
+#include <string>
+#include "latency_histogram.h"
 #include "message.h"
+#include "perf_counters.h"
 
 class Orderbook;
 
 class MarketDataIngestor {
 public:
-  explicit MarketDataIngestor(std::vector<book_message> messages);
+  // an instrumented ingestor times every message with the tsc into a
+  // histogram per action and side; otherwise the replay loop has no timing
+  // code at all
+  explicit MarketDataIngestor(std::vector<book_message> messages,
+                              bool instrumented = false);
   ~MarketDataIngestor();
 
   MarketDataIngestor(const MarketDataIngestor &) = delete;
@@ -29,6 +38,22 @@ public:
   size_t get_total_messages() const;
   double get_curr_rate() const;
 
+  // per message latency in tsc ticks, valid once completed; 'A', 'M' and
+  // 'C' have their own histograms, every other action shares one
+  const LatencyHistogram &latency(char action, bool side) const;
+  // count, p50, p99, p99.9 and max in ns per action and side
+  void print_latency_stats() const;
+  // every non empty bucket as csv: action,side,low_ns,high_ns,count
+  void dump_latency_histograms(std::ostream &out) const;
+
+  // read hardware counters around the replay loop; the replay thread opens
+  // them itself, so set before start()
+  void count_events(bool enabled) { count_events_ = enabled; }
+  // valid once completed; events that could not be opened are not valid
+  const PerfCounters::Sample &event_counts() const { return event_counts_; }
+  // why counters could not be opened, empty if all were
+  const std::string &event_error() const { return event_error_; }
+
 private:
   std::unique_ptr<Orderbook> orderbook_;
   std::vector<book_message> messages_;
@@ -41,6 +66,26 @@ private:
   alignas(64) std::atomic<uint64_t> start_time_ns_{0};
   alignas(64) std::atomic<uint64_t> end_time_ns_{0};
 
+  enum Action { ADD, MODIFY, CANCEL, OTHER, ACTIONS };
+  static constexpr const char *ACTION_NAMES[ACTIONS] = {"add", "modify",
+                                                        "cancel", "other"};
+  using Histograms = std::array<LatencyHistogram, ACTIONS * 2>;
+  // null unless instrumented
+  std::unique_ptr<Histograms> latency_;
+
+  bool count_events_ = false;
+  PerfCounters::Sample event_counts_;
+  std::string event_error_;
+
+  static size_t histogram_index(char action, bool side) {
+    const size_t a = action == 'A'   ? ADD
+                     : action == 'M' ? MODIFY
+                     : action == 'C' ? CANCEL
+                                     : OTHER;
+    return a * 2 + side;
+  }
+
+  template <bool Instrumented>
   void ingest_market_data();
   static void pin_cpu(unsigned cpu_id);
   void start_perf_tracking();
@@ -0,0 +1,70 @@
+#pragma once
+#include "book/orderbook.h"
+#include "message.h"
+#include "message_store.h"
+#include "sampler.h"
+#include "stream_merge.h"
+#include "timer_wheel.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// a strategy that trades on several books at once. instruments are indexed
+// in the order they were added to the replay
+class MultiStrategy : public TimerHandler {
+public:
+  virtual ~MultiStrategy() = default;
+
+  // called after the instrument's book has applied msg, so every book
+  // reflects the same point in time
+  virtual void on_message(size_t instrument, const book_message &msg) = 0;
+  virtual void close_positions() {}
+  void on_timer(uint64_t) override {}
+};
+
+// single threaded replay of several instruments on one clock: the streams
+// are merged by time_ and each message goes to its own instrument's book
+class MergedReplay {
+public:
+  MergedReplay() = default;
+
+  MergedReplay(const MergedReplay &) = delete;
+  MergedReplay &operator=(const MergedReplay &) = delete;
+
+  // messages must be sorted by time_; returns the instrument index
+  size_t add_instrument(const std::string &instrument_id,
+                        std::vector<book_message> &&messages);
+  size_t add_instrument(const std::string &instrument_id,
+                        std::shared_ptr<const MessageStore> messages);
+
+  size_t instrument_count() const { return instruments_.size(); }
+  const std::string &instrument_id(size_t i) const {
+    return instruments_[i]->id_;
+  }
+  Orderbook &book(size_t i) { return *instruments_[i]->book_; }
+  const Orderbook &book(size_t i) const { return *instruments_[i]->book_; }
+  SamplerSet &samplers(size_t i) { return instruments_[i]->samplers_; }
+  TimerWheel &timers() { return timers_; }
+
+  void set_strategy(MultiStrategy *strategy) { strategy_ = strategy; }
+  void set_session(uint64_t start_ns, uint64_t end_ns);
+
+  void run();
+  void stop() { running_ = false; }
+
+private:
+  struct Instrument {
+    std::string id_;
+    std::shared_ptr<const MessageStore> messages_;
+    std::unique_ptr<Orderbook> book_;
+    SamplerSet samplers_;
+  };
+
+  std::vector<std::unique_ptr<Instrument>> instruments_;
+  MultiStrategy *strategy_ = nullptr;
+  TimerWheel timers_;
+  std::atomic<bool> running_{false};
+  uint64_t start_ns_ = 0;
+  uint64_t end_ns_ = UINT64_MAX;
+};
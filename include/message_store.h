@@ -0,0 +1,60 @@
+#pragma once
+#include "message.h"
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+// one day's messages, immutable and shared. every backtester, trainer and
+// extractor over the same day views the same records through a span, so n
+// concurrent runs hold one copy. the records live in whichever backing the
+// store was built from: an adopted vector, an anonymous hugepage mapping or
+// a read-only file mapping
+class MessageStore {
+public:
+  // takes the vector's buffer, no copy
+  static std::shared_ptr<const MessageStore>
+  adopt(std::vector<book_message> &&messages);
+
+  // copies into an anonymous mapping backed by hugepages when the system
+  // has them reserved, transparent hugepages otherwise
+  static std::shared_ptr<const MessageStore>
+  copy_to_hugepages(std::span<const book_message> messages);
+
+  // maps a file written by save(); the page cache is then shared with every
+  // other process replaying the same day. with a source, the file is
+  // rejected unless it was saved from that source at its current size and
+  // modification time
+  static std::shared_ptr<const MessageStore>
+  map_file(const std::filesystem::path &path,
+           const std::filesystem::path &source = {});
+
+  // source is the file the messages were parsed from, stamped into the
+  // header for map_file to check
+  static void save(const std::filesystem::path &path,
+                   std::span<const book_message> messages,
+                   const std::filesystem::path &source = {});
+
+  MessageStore(const MessageStore &) = delete;
+  MessageStore &operator=(const MessageStore &) = delete;
+  ~MessageStore();
+
+  std::span<const book_message> messages() const { return {data_, size_}; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // FeatureStore::hash_messages over the records, computed once
+  uint64_t hash() const;
+
+private:
+  MessageStore() = default;
+
+  const book_message *data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<book_message> owned_;
+  void *mapping_ = nullptr;
+  size_t mapping_bytes_ = 0;
+  mutable std::once_flag hash_once_;
+  mutable uint64_t hash_ = 0;
+};
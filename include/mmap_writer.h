@@ -0,0 +1,70 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+// append only file writer over a sliding shared mapping. the file is mapped
+// one fixed size segment at a time at increasing offsets; a full segment is
+// unmapped and the next one mapped past it. a write that does not fit in
+// the last segment of a file rolls over to <stem>.<n><ext> first, so every
+// write lands whole in one file. flush() only starts writeback of the bytes
+// written since the previous flush, and close() truncates each file to what
+// was written
+class SegmentedMmapWriter {
+public:
+  static constexpr size_t DEFAULT_SEGMENT_BYTES = 8 * 1024 * 1024;
+
+  // max_file_bytes of 0 never rolls over. header is written at the start of
+  // every file, including rolled ones
+  explicit SegmentedMmapWriter(std::filesystem::path path,
+                               size_t segment_bytes = DEFAULT_SEGMENT_BYTES,
+                               uint64_t max_file_bytes = 0,
+                               std::string header = "");
+  ~SegmentedMmapWriter();
+
+  SegmentedMmapWriter(const SegmentedMmapWriter &) = delete;
+  SegmentedMmapWriter &operator=(const SegmentedMmapWriter &) = delete;
+
+  inline void write(const char *data, size_t size) {
+    if (size <= capacity_ - offset_) {
+      __builtin_memcpy(segment_ + offset_, data, size);
+      offset_ += size;
+      return;
+    }
+    write_slow(data, size);
+  }
+
+  // asynchronous: queues the dirty range for writeback and returns
+  void flush();
+  void close();
+
+  // bytes in the current file
+  uint64_t size() const { return segment_start_ + offset_; }
+  size_t files() const { return file_index_ + 1; }
+  const std::filesystem::path &current_path() const { return current_path_; }
+
+private:
+  void write_slow(const char *data, size_t size);
+  void open_file();
+  void close_file();
+  void map_segment(uint64_t file_offset);
+  void unmap_segment();
+
+  std::filesystem::path path_;
+  std::filesystem::path current_path_;
+  size_t segment_bytes_;
+  uint64_t max_file_bytes_;
+  std::string header_;
+
+  int fd_ = -1;
+  size_t file_index_ = 0;
+  char *segment_ = nullptr;
+  // segment_bytes_ while a segment is mapped, 0 otherwise
+  size_t capacity_ = 0;
+  // file offset of the mapped segment and the write position inside it
+  uint64_t segment_start_ = 0;
+  size_t offset_ = 0;
+  // everything below this file offset has had writeback started
+  uint64_t synced_ = 0;
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// hardware and software counters of the calling thread, read through
+// perf_event_open. each event is opened on its own, so one the cpu, the
+// hypervisor or perf_event_paranoid does not allow only costs that event.
+// counts of events the pmu had to time share are scaled up by the fraction
+// of time they were counting
+class PerfCounters {
+public:
+  enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    DTLB_MISSES,
+    PAGE_FAULTS,
+    EVENTS
+  };
+  static constexpr const char *NAMES[EVENTS] = {
+      "cycles",        "instructions", "L1d misses", "LLC misses",
+      "branch misses", "dTLB misses",  "page faults"};
+
+  struct Sample {
+    std::array<uint64_t, EVENTS> values_{};
+    std::array<bool, EVENTS> valid_{};
+
+    bool valid(Event e) const { return valid_[e]; }
+    uint64_t value(Event e) const { return values_[e]; }
+  };
+
+  PerfCounters() {
+    for (int e = 0; e < EVENTS; ++e) {
+      fds_[e] = open_event(static_cast<Event>(e));
+      if (fds_[e] < 0 && error_.empty()) {
+        error_ = std::string(NAMES[e]) + ": " + std::strerror(errno);
+      }
+    }
+  }
+
+  ~PerfCounters() {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool available() const {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // why the first event that failed could not be opened, empty if none did
+  const std::string &error() const { return error_; }
+
+  void start() {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+      }
+    }
+  }
+
+  // counts since start()
+  Sample stop() {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+      }
+    }
+    Sample sample;
+    for (int e = 0; e < EVENTS; ++e) {
+      // value, time enabled, time running
+      uint64_t read_format[3];
+      if (fds_[e] < 0 ||
+          read(fds_[e], read_format, sizeof(read_format)) !=
+              sizeof(read_format) ||
+          read_format[2] == 0) {
+        continue;
+      }
+      sample.valid_[e] = true;
+      sample.values_[e] =
+          read_format[2] < read_format[1]
+              ? static_cast<uint64_t>(static_cast<double>(read_format[0]) *
+                                      read_format[1] / read_format[2])
+              : read_format[0];
+    }
+    return sample;
+  }
+
+private:
+  static int open_event(Event event) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    auto cache = [](uint64_t cache_id) {
+      return cache_id | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    };
+    switch (event) {
+    case CYCLES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_CPU_CYCLES;
+      break;
+    case INSTRUCTIONS:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+      break;
+    case L1D_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = cache(PERF_COUNT_HW_CACHE_L1D);
+      break;
+    case LLC_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = cache(PERF_COUNT_HW_CACHE_LL);
+      break;
+    case BRANCH_MISSES:
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+      break;
+    case DTLB_MISSES:
+      attr.type = PERF_TYPE_HW_CACHE;
+      attr.config = cache(PERF_COUNT_HW_CACHE_DTLB);
+      break;
+    default:
+      attr.type = PERF_TYPE_SOFTWARE;
+      attr.config = PERF_COUNT_SW_PAGE_FAULTS;
+      break;
+    }
+
+    // this thread, on any cpu
+    auto open = [&attr] {
+      return static_cast<int>(
+          syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    };
+    int fd = open();
+    if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+      // perf_event_paranoid 2 still allows counting user space
+      attr.exclude_kernel = 1;
+      fd = open();
+    }
+    return fd;
+  }
+
+  std::array<int, EVENTS> fds_{};
+  std::string error_;
+};
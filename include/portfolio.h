@@ -0,0 +1,119 @@
+#pragma once
+#include "spsc_ring.h"
+#include "strategy_metrics.h"
+#include "wait_strategy.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PortfolioPoint {
+  uint64_t time_ = 0;
+  int64_t pnl_ = 0;
+  // sum of position * mark price * point value, signed and absolute
+  int64_t net_exposure_ = 0;
+  int64_t gross_exposure_ = 0;
+};
+
+struct PortfolioResult {
+  std::vector<PortfolioPoint> curve_;
+  std::vector<std::string> instruments_;
+  // last pnl each instrument reported, in add order
+  std::vector<int64_t> instrument_pnl_;
+  int64_t max_gross_exposure_ = 0;
+  StrategyMetrics metrics_;
+};
+
+// merges the marks and fills of instruments replayed on separate threads into
+// one portfolio equity curve on simulated time. each instrument publishes
+// into its own queue and never waits on the aggregator; the aggregator only
+// advances to the watermark, the earliest time every unfinished instrument
+// has already reached, so the curve is in time order however the threads
+// interleave
+class PortfolioAggregator {
+public:
+  struct Event {
+    enum Kind : uint8_t { MARK, FILL, DONE };
+    uint64_t time_ = 0;
+    int64_t pnl_ = 0;
+    int32_t position_ = 0;
+    int32_t price_ = 0;
+    int32_t point_value_ = 0;
+    Kind kind_ = MARK;
+  };
+
+  // handed to exactly one instrument thread
+  class Producer {
+  public:
+    // pnl marked at price with the position held at time_ns
+    void mark(uint64_t time_ns, int64_t pnl, int position, int32_t price,
+              int32_t point_value);
+    // position after the fill, so exposure moves between marks
+    void fill(uint64_t time_ns, int position, int32_t price,
+              int32_t point_value);
+    // no more events from this instrument. waits for the backlog to drain,
+    // which only happens once its replay is over
+    void finish();
+
+  private:
+    friend class PortfolioAggregator;
+    static constexpr size_t QUEUE_SIZE = 1 << 14;
+
+    void publish(const Event &event);
+
+    SpscRing<Event> queue_{QUEUE_SIZE};
+    // the aggregator's, woken after every push
+    WaitStrategy *wait_ = nullptr;
+    // producer side overflow when the aggregator falls behind, so publishing
+    // never blocks and never drops
+    std::deque<Event> backlog_;
+    bool finished_ = false;
+  };
+
+  // the aggregator parks by default; BUSY_SPIN keeps its core and follows
+  // the instruments without wakes
+  explicit PortfolioAggregator(WaitMode wait = WaitMode::SPIN_PARK)
+      : wait_(wait) {}
+  ~PortfolioAggregator();
+
+  PortfolioAggregator(const PortfolioAggregator &) = delete;
+  PortfolioAggregator &operator=(const PortfolioAggregator &) = delete;
+
+  // all instruments are added before start()
+  Producer &add_instrument(const std::string &instrument_id);
+
+  void start();
+  // returns once every producer has finished and the curve is complete
+  PortfolioResult finish();
+
+private:
+  struct Lane {
+    std::string id_;
+    std::unique_ptr<Producer> producer_;
+    // consumer side, events drained but not yet past the watermark
+    std::vector<Event> pending_;
+    size_t next_ = 0;
+    uint64_t seen_ns_ = 0;
+    bool done_ = false;
+    // state as of the last applied event
+    int64_t pnl_ = 0;
+    int64_t exposure_ = 0;
+  };
+
+  void run();
+  bool drain();
+  bool has_events() const;
+  void apply(Lane &lane, const Event &event);
+  void commit();
+
+  std::vector<Lane> lanes_;
+  PortfolioResult result_;
+  PortfolioPoint current_;
+  std::thread thread_;
+  std::atomic<bool> stop_{false};
+  // parks the aggregator while every queue is empty
+  WaitStrategy wait_;
+};
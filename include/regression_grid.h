@@ -0,0 +1,59 @@
+#pragma once
+#include <Eigen/Dense>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// sufficient statistics for regressing average forward mid changes on lagged
+// voi. columns are [1, voi_t, voi_t-1, ..., voi_t-max_lag], so the design for
+// any lag <= max_lag is a leading sub-block. one target column per horizon.
+// stats from disjoint samples (e.g. separate days) add up
+struct GridStats {
+  int max_lag_ = 0;
+  std::vector<int> horizons_;
+  Eigen::MatrixXd gram_;
+  Eigen::MatrixXd xty_;
+  Eigen::VectorXd yty_;
+  size_t rows_ = 0;
+
+  GridStats &operator+=(const GridStats &other);
+};
+
+struct GridFit {
+  int lag_ = 0;
+  int horizon_ = 0;
+  std::vector<double> coefficients_;
+  double sse_ = 0.0;
+  double r2_ = 0.0;
+  size_t rows_ = 0;
+};
+
+class RegressionGrid {
+public:
+  explicit RegressionGrid(int max_lag, std::vector<int> horizons,
+                          unsigned threads = 0);
+
+  // one pass over the series: prefix sums of mid give every horizon's target
+  // in O(1) per row, and the rows are split across threads
+  [[nodiscard]] GridStats accumulate(std::span<const int32_t> voi,
+                                     std::span<const int32_t> mid) const;
+
+  [[nodiscard]] GridFit solve(const GridStats &stats, int lag,
+                              size_t horizon_idx) const;
+
+  // every (lag <= max_lag, horizon) cell, solved in parallel
+  [[nodiscard]] std::vector<GridFit> solve_all(const GridStats &stats) const;
+
+  [[nodiscard]] std::vector<GridFit> fit(std::span<const int32_t> voi,
+                                         std::span<const int32_t> mid) const {
+    return solve_all(accumulate(voi, mid));
+  }
+
+  [[nodiscard]] GridStats empty_stats() const;
+
+private:
+  int max_lag_;
+  std::vector<int> horizons_;
+  int max_horizon_;
+  unsigned threads_;
+};
@@ -0,0 +1,83 @@
+#pragma once
+#include "strategy_metrics.h"
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+// what one session left behind, enough to stitch days replayed in parallel
+struct DayResult {
+  std::string file_;
+  int64_t pnl_ = 0;
+  int position_ = 0;
+  int32_t point_value_ = 0;
+  int32_t open_bid_ = 0;
+  int32_t open_ask_ = 0;
+  int32_t close_bid_ = 0;
+  int32_t close_ask_ = 0;
+  size_t messages_ = 0;
+};
+
+struct TradeRecord {
+  uint64_t time_ = 0;
+  int32_t price_ = 0;
+  // +1 buy, -1 sell
+  int32_t side_ = 0;
+};
+
+// marked pnl at each strategy bar, with the position and the mid it was
+// marked at
+struct PnlPoint {
+  uint64_t time_ = 0;
+  int64_t pnl_ = 0;
+  int32_t position_ = 0;
+  int32_t price_ = 0;
+};
+
+struct BacktestResult {
+  DayResult summary_;
+  std::vector<TradeRecord> trades_;
+  std::vector<PnlPoint> pnl_curve_;
+  StrategyMetrics metrics_;
+};
+
+// everything a session's outcome depends on. params_ is the strategy's own
+// canonical description of its settings and version_ its logic revision, so
+// changing either misses the cache instead of returning a stale result
+struct ResultKey {
+  uint64_t data_hash_ = 0;
+  uint64_t train_hash_ = 0;
+  // the opening book the day was replayed onto, 0 for an empty one
+  uint64_t opening_hash_ = 0;
+  uint64_t start_ns_ = 0;
+  uint64_t end_ns_ = UINT64_MAX;
+  uint64_t train_start_ns_ = 0;
+  uint64_t train_end_ns_ = UINT64_MAX;
+  bool flatten_at_close_ = true;
+  std::string strategy_;
+  std::string params_;
+  uint32_t version_ = 0;
+
+  std::string canonical() const;
+  uint64_t hash() const;
+};
+
+// one file per finished session:
+//   <root>/<key hash>.res
+// the file repeats the canonical key, so a hash collision reads as a miss
+class ResultCache {
+public:
+  // bump when the replay loop itself changes what a session produces
+  static constexpr uint32_t ENGINE_VERSION = 1;
+
+  explicit ResultCache(std::filesystem::path root = "result_cache");
+
+  std::optional<BacktestResult> open(const ResultKey &key) const;
+  void save(const ResultKey &key, const BacktestResult &result) const;
+
+private:
+  std::filesystem::path path_for(const ResultKey &key) const;
+
+  std::filesystem::path root_;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include <Eigen/Dense>
+#include <cstddef>
+
+// exponentially weighted recursive least squares over a fixed number of
+// regressors. each update is O(P^2) and allocation free
+template <int P>
+class RlsEstimator {
+public:
+  using Vector = Eigen::Matrix<double, P, 1>;
+  using Matrix = Eigen::Matrix<double, P, P>;
+
+  explicit RlsEstimator(double forgetting = 0.9995, double delta = 1e3)
+      : lambda_(forgetting), delta_(delta) {
+    reset();
+  }
+
+  void reset() {
+    w_.setZero();
+    P_ = Matrix::Identity() * delta_;
+    samples_ = 0;
+  }
+
+  // continue from a batch least squares fit. gram is X'X of the batch design
+  // matrix; a small ridge keeps the inverse finite when a lag column is
+  // degenerate
+  void warm_start(const Vector &coeffs, const Matrix &gram) {
+    w_ = coeffs;
+    P_ = (gram + Matrix::Identity() * 1e-9).ldlt().solve(
+        Matrix::Identity());
+  }
+
+  void update(const Vector &x, double y) {
+    const Vector px = P_ * x;
+    const double denom = lambda_ + x.dot(px);
+    const Vector k = px / denom;
+    w_ += k * (y - w_.dot(x));
+    P_ = (P_ - k * px.transpose()) / lambda_;
+    P_ = 0.5 * (P_ + P_.transpose());
+    ++samples_;
+  }
+
+  [[nodiscard]] double predict(const Vector &x) const { return w_.dot(x); }
+  [[nodiscard]] const Vector &coefficients() const { return w_; }
+  [[nodiscard]] size_t samples() const { return samples_; }
+
+private:
+  double lambda_;
+  double delta_;
+  Vector w_;
+  Matrix P_;
+  size_t samples_ = 0;
+};
@@ -0,0 +1,176 @@
+#pragma once
+#include "book/orderbook.h"
+#include "message.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// a bar summarises the messages seen between two sampler emissions. every
+// field is integer and built incrementally, so closing a bar is O(1)
+struct Bar {
+  uint64_t open_time_ = 0;
+  uint64_t close_time_ = 0;
+  uint64_t messages_ = 0;
+  uint64_t trades_ = 0;
+  uint64_t volume_ = 0;
+  int32_t bid_ = 0;
+  int32_t ask_ = 0;
+};
+
+class Sampler {
+public:
+  using Callback = std::function<void(const Bar &)>;
+
+  virtual ~Sampler() = default;
+
+  void subscribe(Callback cb) { subscribers_.push_back(std::move(cb)); }
+
+  // feed one message after it has been applied to the book
+  inline void on_message(const book_message &m, const Orderbook &book) {
+    if (bar_.messages_ == 0) {
+      bar_.open_time_ = m.time_;
+    }
+    ++bar_.messages_;
+    if (m.action_ == 'T') {
+      ++bar_.trades_;
+      bar_.volume_ += static_cast<uint64_t>(m.size_);
+    }
+
+    if (!should_close(m, book)) {
+      return;
+    }
+
+    bar_.close_time_ = m.time_;
+    bar_.bid_ = book.get_best_bid_price();
+    bar_.ask_ = book.get_best_ask_price();
+    for (auto &cb : subscribers_) {
+      cb(bar_);
+    }
+    bar_ = Bar{};
+  }
+
+  virtual void reset() { bar_ = Bar{}; }
+
+protected:
+  virtual bool should_close(const book_message &m, const Orderbook &book) = 0;
+
+  Bar bar_;
+
+private:
+  std::vector<Callback> subscribers_;
+};
+
+// closes a bar on the first message at or past each interval boundary. the
+// first boundary is aligned to the interval after the first message seen
+class TimeSampler : public Sampler {
+public:
+  explicit TimeSampler(uint64_t interval_ns) : interval_ns_(interval_ns) {}
+
+  void reset() override {
+    Sampler::reset();
+    next_close_ = 0;
+  }
+
+protected:
+  bool should_close(const book_message &m, const Orderbook &) override {
+    if (next_close_ == 0) {
+      next_close_ = (m.time_ / interval_ns_ + 1) * interval_ns_;
+      return false;
+    }
+    if (m.time_ < next_close_) {
+      return false;
+    }
+    next_close_ = (m.time_ / interval_ns_ + 1) * interval_ns_;
+    return true;
+  }
+
+private:
+  uint64_t interval_ns_;
+  uint64_t next_close_ = 0;
+};
+
+// closes a bar once the traded volume reaches the threshold
+class VolumeSampler : public Sampler {
+public:
+  explicit VolumeSampler(uint64_t volume) : volume_(volume) {}
+
+protected:
+  bool should_close(const book_message &, const Orderbook &) override {
+    return bar_.volume_ >= volume_;
+  }
+
+private:
+  uint64_t volume_;
+};
+
+// closes a bar every n trades
+class TickSampler : public Sampler {
+public:
+  explicit TickSampler(uint64_t ticks) : ticks_(ticks) {}
+
+protected:
+  bool should_close(const book_message &, const Orderbook &) override {
+    return bar_.trades_ >= ticks_;
+  }
+
+private:
+  uint64_t ticks_;
+};
+
+// closes a bar whenever the best bid or ask price changes
+class BookEventSampler : public Sampler {
+public:
+  void reset() override {
+    Sampler::reset();
+    prev_bid_ = 0;
+    prev_ask_ = 0;
+  }
+
+protected:
+  bool should_close(const book_message &, const Orderbook &book) override {
+    const int32_t bid = book.get_best_bid_price();
+    const int32_t ask = book.get_best_ask_price();
+    if (bid == prev_bid_ && ask == prev_ask_) {
+      return false;
+    }
+    prev_bid_ = bid;
+    prev_ask_ = ask;
+    return true;
+  }
+
+private:
+  int32_t prev_bid_ = 0;
+  int32_t prev_ask_ = 0;
+};
+
+// fans one message stream out to several samplers so a single replay can
+// drive every cadence a run needs
+class SamplerSet {
+public:
+  template <typename T, typename... Args>
+  T &add(Args &&...args) {
+    auto sampler = std::make_unique<T>(std::forward<Args>(args)...);
+    T &ref = *sampler;
+    samplers_.push_back(std::move(sampler));
+    return ref;
+  }
+
+  inline void on_message(const book_message &m, const Orderbook &book) {
+    for (auto &s : samplers_) {
+      s->on_message(m, book);
+    }
+  }
+
+  void reset() {
+    for (auto &s : samplers_) {
+      s->reset();
+    }
+  }
+
+  void clear() { samplers_.clear(); }
+  bool empty() const { return samplers_.empty(); }
+
+private:
+  std::vector<std::unique_ptr<Sampler>> samplers_;
+};
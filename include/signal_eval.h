@@ -0,0 +1,58 @@
+#pragma once
+#include "feature_store.h"
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// parameters of a lagged-voi linear signal traded like LinearModelStrategy:
+// buy one lot at the ask when the prediction is >= threshold, sell one at the
+// bid when <= -threshold, within +/- max_position, flatten on the last row.
+// the first coefficients_.size() - 2 rows have no full lag window and are
+// never traded
+struct SignalParams {
+  std::vector<double> coefficients_;
+  // must be positive; at 0 a flat prediction would buy
+  double threshold_ = 0.0;
+  int max_position_ = 1;
+  int32_t point_value_ = 1;
+  int32_t fees_per_side_ = 1;
+};
+
+struct SignalTrade {
+  uint32_t row_;
+  bool is_buy_;
+  int32_t price_;
+};
+
+struct SignalResult {
+  std::vector<SignalTrade> trades_;
+  int64_t pnl_ = 0;
+  int64_t fees_ = 0;
+};
+
+// whole-day evaluation over a feature column block instead of a book replay.
+// predictions are computed for every row with simd kernels (avx-512 or avx2
+// when the cpu has them), then the position state machine runs as a tight
+// scalar pass
+class SignalEvaluator {
+public:
+  // out[t] = c0 + sum_j c[j + 1] * voi[t - j] for t >= lag, 0 before that
+  static void predict(std::span<const int32_t> voi,
+                      std::span<const double> coefficients,
+                      std::span<double> out);
+
+  static SignalResult simulate(std::span<const double> predictions,
+                               std::span<const int32_t> bid,
+                               std::span<const int32_t> ask,
+                               const SignalParams &params);
+
+  // frame needs the voi, bid and ask columns
+  static SignalResult evaluate(const FeatureFrame &frame,
+                               const SignalParams &params);
+
+  // consecutive params with identical coefficients share one prediction
+  // pass; chunks of the grid run on separate threads
+  static std::vector<SignalResult>
+  evaluate_grid(const FeatureFrame &frame, std::span<const SignalParams> grid,
+                unsigned threads = 0);
+};
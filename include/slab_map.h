@@ -19,11 +19,13 @@ inline Page *alloc_page() {
       mmap(nullptr, PAGE_BYTES, PROT_READ | PROT_WRITE,
            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
   if (mem == MAP_FAILED) {
-    mem = std::aligned_alloc(64, PAGE_BYTES);
-    if (!mem) {
+    // no hugepages reserved; a plain anonymous map is still zero filled
+    // (lazily, on first touch) and released by the same munmap
+    mem = mmap(nullptr, PAGE_BYTES, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
       throw std::bad_alloc();
     }
-    //std::memset(mem, 0, PAGE_BYTES);
   }
   return static_cast<Page *>(mem);
 }
@@ -93,6 +95,19 @@ public:
   void erase(uint64_t id) { *slot_ptr(id) = nullptr; }
   Order *find(uint64_t id) { return *slot_ptr(id); }
 
+  // keeps every page mapped for reuse. only valid once all ids were erased,
+  // so the recycled pages are all null again
+  void recycle() {
+    for (Page *p : pages_) {
+      if (p) {
+        free_pages_.push_back(p);
+      }
+    }
+    pages_.clear();
+    base_id_ = 0;
+    base_page_ = 0;
+  }
+
   void clear() {
     for (Page *p : pages_)
       if (p) {
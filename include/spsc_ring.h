@@ -0,0 +1,114 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// bounded queue for exactly one producer thread and one consumer thread.
+// capacity is rounded up to a power of two at construction, so indices are
+// free running counters and a slot is index & mask_. each side keeps a
+// private copy of the other side's index and only reloads the shared atomic
+// when that copy says the ring is full (or empty), so a steady stream
+// touches the other side's cache line about once per capacity items. the
+// _n variants move a whole batch per index publish
+template <typename T>
+class SpscRing {
+public:
+  explicit SpscRing(size_t min_capacity)
+      : capacity_(std::bit_ceil(std::max<size_t>(min_capacity, 2))),
+        mask_(capacity_ - 1), slots_(std::make_unique<T[]>(capacity_)) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  // producer side
+
+  template <typename U>
+  __attribute__((always_inline))
+  bool try_push(U &&item) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == capacity_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == capacity_) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::forward<U>(item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // pushes as many of items[0, n) as fit; returns how many
+  size_t try_push_n(const T *items, size_t n) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    size_t free = capacity_ - (tail - cached_head_);
+    if (free < n) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      free = capacity_ - (tail - cached_head_);
+    }
+    const size_t count = std::min(n, free);
+    for (size_t i = 0; i < count; ++i) {
+      slots_[(tail + i) & mask_] = items[i];
+    }
+    if (count) {
+      tail_.store(tail + count, std::memory_order_release);
+    }
+    return count;
+  }
+
+  // consumer side
+
+  __attribute__((always_inline))
+  bool try_pop(T &out) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return false;
+      }
+    }
+    out = std::move(slots_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // pops up to max items into out; returns how many
+  size_t try_pop_n(T *out, size_t max) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    size_t available = cached_tail_ - head;
+    if (available < max) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      available = cached_tail_ - head;
+    }
+    const size_t count = std::min(max, available);
+    for (size_t i = 0; i < count; ++i) {
+      out[i] = std::move(slots_[(head + i) & mask_]);
+    }
+    if (count) {
+      head_.store(head + count, std::memory_order_release);
+    }
+    return count;
+  }
+
+  // exact from either side only when the other side is idle
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  size_t capacity() const { return capacity_; }
+
+private:
+  const size_t capacity_;
+  const size_t mask_;
+  const std::unique_ptr<T[]> slots_;
+
+  // consumer line: its index and its view of the producer's
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+  // producer line
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+};
@@ -1,36 +1,55 @@
 #pragma once
 #include "../include/book/orderbook.h"
 #include "async_logger.h"
-#include "connection_pool.h"
+#include "coro_scheduler.h"
+#include "feature_store.h"
+#include "sampler.h"
+#include "strategy_metrics.h"
+#include "timer_wheel.h"
 #include <cstring>
 #include <iostream>
 #include <memory>
+#include <queue>
+#include <tuple>
 
-class Strategy {
+class Strategy : public TimerHandler {
 protected:
   int position_ = 0;
   int buy_qty_;
   int sell_qty_;
-  int32_t real_total_buy_px_;
-  int32_t real_total_sell_px_;
-  int32_t theo_total_buy_px_;
-  int32_t theo_total_sell_px_;
-  float fees_;
-  int32_t pnl_;
+  int64_t real_total_buy_px_;
+  int64_t real_total_sell_px_;
+  int64_t theo_total_buy_px_;
+  int64_t theo_total_sell_px_;
+  int64_t fees_;
+  int64_t pnl_;
   static constexpr int max_pos_ = 1;
   int32_t POINT_VALUE_;
   static constexpr int32_t FEES_PER_SIDE_ = 1;
-  int32_t prev_pnl_;
+  int64_t prev_pnl_;
+  StrategyMetrics metrics_;
   std::unique_ptr<AsyncLogger> logger_;
-  std::shared_ptr<ConnectionPool> connection_pool_;
   Orderbook *book_;
+  TimerWheel *timers_ = nullptr;
+  CoroScheduler *tasks_ = nullptr;
   std::string id_;
 
   virtual void update_theo_values() = 0;
   virtual void calculate_pnl() = 0;
 
+  // every fill goes through here, so the backtester sees it on trade_queue_
+  // and the metrics see it at the current simulated time
+  void record_fill(bool is_buy, int32_t price, int qty) {
+    trade_queue_.emplace(is_buy, price);
+    metrics_.on_fill(now_ns(), is_buy, price, qty, POINT_VALUE_,
+                     FEES_PER_SIDE_);
+  }
+
+  // simulated time of the message being replayed
+  uint64_t now_ns() const { return timers_ ? timers_->now_ns() : 0; }
+
 public:
-  Strategy(std::shared_ptr<ConnectionPool> pool,
+  Strategy(const LogConfig &logging,
            const std::string &log_file_name,
            const std::string &instrument_id,
            Orderbook *book) :
@@ -44,19 +63,11 @@ public:
     , fees_(0)
     , pnl_(0)
     , prev_pnl_(0)
-    , connection_pool_(pool)
     , book_(book)
     , req_fitting_(false) {
 
-    Connection *db_connection = connection_pool_->acquire_connection();
-    if (!db_connection) {
-      throw std::runtime_error(
-          "failed to acquire database connection for logger");
-    }
-
-    logger_ = std::make_unique<AsyncLogger>(db_connection, log_file_name,
-                                            instrument_id);
-
+    logger_ = std::make_unique<AsyncLogger>(log_file_name, instrument_id,
+                                            logging);
   }
 
   std::queue<std::tuple<bool, int32_t>> trade_queue_;
@@ -66,7 +77,21 @@ public:
   std::string name_;
   bool req_fitting_;
 
-  virtual void fit_model() = 0;
+  // fit on the training day's sampled features; columns may be mapped
+  // straight from the feature cache
+  virtual void fit_model(const FeatureFrame &train) = 0;
+
+  // columns of the traded day the strategy reads instead of recomputing
+  // them on every bar, 0 for none. row k of the frame given to
+  // attach_features is the k-th bar of the default cadence
+  virtual uint32_t feature_columns() const { return 0; }
+  virtual void attach_features(FeatureFrame) {}
+
+  // identify a run for the result cache: params() lists every setting that
+  // changes what the strategy trades, version() is bumped whenever its
+  // trading logic changes
+  virtual std::string params() const = 0;
+  virtual uint32_t version() const = 0;
 
   virtual void reset() {
     position_ = 0;
@@ -79,14 +104,48 @@ public:
     fees_ = 0;
     pnl_ = 0;
     prev_pnl_ = 0;
+    metrics_.reset();
   }
 
   virtual ~Strategy() = default;
 
+  static constexpr uint64_t BAR_INTERVAL_NS = 1'000'000'000;
+
+  // register for the bars this strategy trades on. the default is one second
+  // time bars feeding on_book_update; override to pick another cadence
+  virtual void subscribe(SamplerSet &samplers) {
+    samplers.add<TimeSampler>(BAR_INTERVAL_NS)
+        .subscribe([this](const Bar &bar) { on_bar(bar); });
+  }
+
+  virtual void on_bar(const Bar &) { on_book_update(); }
+
+  // simulated time timers, fired by the replay loop between messages
+  void attach_timers(TimerWheel *timers) { timers_ = timers; }
+  TimerWheel::TimerId schedule_timer(uint64_t delay_ns, uint64_t tag = 0) {
+    return timers_->schedule_after(delay_ns, this, tag);
+  }
+  bool cancel_timer(TimerWheel::TimerId id) { return timers_->cancel(id); }
+  bool rearm_timer(TimerWheel::TimerId id, uint64_t delay_ns) {
+    return timers_->rearm_after(id, delay_ns);
+  }
+  void on_timer(uint64_t) override {}
+
+  // coroutine tasks resumed from the replay loop. spawn_tasks runs once at
+  // the start of the backtest; tasks may also be spawned from callbacks
+  void attach_scheduler(CoroScheduler *tasks) { tasks_ = tasks; }
+  virtual void spawn_tasks() {}
+
   virtual void on_book_update() = 0;
   virtual void execute_trade(bool side, int32_t price, int size) = 0;
 
-  int32_t get_pnl() const { return pnl_; }
+  // marks the current pnl into the metrics, called by the replay loop
+  void mark(uint64_t time_ns) { metrics_.on_mark(time_ns, pnl_); }
+  const StrategyMetrics &metrics() const { return metrics_; }
+
+  int64_t get_pnl() const { return pnl_; }
   int get_position() const { return position_; }
+  int32_t get_point_value() const { return POINT_VALUE_; }
+  static constexpr int32_t fees_per_side() { return FEES_PER_SIDE_; }
   bool requires_fitting() const { return req_fitting_; }
 };
\ No newline at end of file
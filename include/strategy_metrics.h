@@ -0,0 +1,163 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+// running risk and performance statistics for one strategy, updated in O(1)
+// on every fill and every pnl mark. everything is kept in the strategy's
+// integer pnl units (price ticks times point value) in int64, with the sum
+// of squared returns in 128 bits, so a full session on nq cannot overflow.
+// ratios are only formed when read
+class StrategyMetrics {
+public:
+  // fee is the total charged on this fill
+  inline void on_fill(uint64_t time_ns, bool is_buy, int32_t price, int qty,
+                      int32_t point_value, int64_t fee) {
+    ++fills_;
+    contracts_ += static_cast<uint64_t>(qty);
+    notional_ += static_cast<int64_t>(price) * qty * point_value;
+    fees_ += fee;
+
+    const int signed_qty = is_buy ? qty : -qty;
+    const int64_t value = static_cast<int64_t>(price) * point_value;
+
+    if (position_ != 0 && (position_ > 0) != (signed_qty > 0)) {
+      // reducing or flipping: the part that flattens closes the round trip
+      const int closing = std::min(std::abs(signed_qty), std::abs(position_));
+      trip_cash_ += (is_buy ? -value : value) * closing - fee;
+      position_ += is_buy ? closing : -closing;
+      if (position_ == 0) {
+        close_trip(time_ns);
+      }
+      const int rest = std::abs(signed_qty) - closing;
+      if (rest > 0) {
+        open_trip(time_ns);
+        trip_cash_ += (is_buy ? -value : value) * rest;
+        position_ += is_buy ? rest : -rest;
+      }
+      return;
+    }
+
+    if (position_ == 0) {
+      open_trip(time_ns);
+    }
+    trip_cash_ += (is_buy ? -value : value) * qty - fee;
+    position_ += signed_qty;
+  }
+
+  // pnl marked to market, e.g. once per bar
+  inline void on_mark(uint64_t time_ns, int64_t pnl) {
+    if (marks_ > 0) {
+      const int64_t r = pnl - last_pnl_;
+      ++returns_;
+      sum_returns_ += r;
+      sum_sq_returns_ += static_cast<__int128>(r) * r;
+    } else {
+      peak_pnl_ = pnl;
+    }
+    ++marks_;
+    last_pnl_ = pnl;
+    last_mark_ns_ = time_ns;
+    peak_pnl_ = std::max(peak_pnl_, pnl);
+    max_drawdown_ = std::max(max_drawdown_, peak_pnl_ - pnl);
+  }
+
+  void reset() { *this = StrategyMetrics{}; }
+
+  int64_t pnl() const { return last_pnl_; }
+  int64_t peak_pnl() const { return peak_pnl_; }
+  int64_t max_drawdown() const { return max_drawdown_; }
+  int64_t fees() const { return fees_; }
+
+  uint64_t marks() const { return marks_; }
+  double mean_return() const {
+    return returns_ ? static_cast<double>(sum_returns_) / returns_ : 0.0;
+  }
+  double return_stddev() const {
+    if (returns_ < 2) {
+      return 0.0;
+    }
+    const double n = static_cast<double>(returns_);
+    const double mean = static_cast<double>(sum_returns_) / n;
+    const double var =
+        (static_cast<double>(sum_sq_returns_) - n * mean * mean) / (n - 1);
+    return var > 0 ? std::sqrt(var) : 0.0;
+  }
+  // per mark sharpe scaled by the number of marks in a year
+  double sharpe(double marks_per_year) const {
+    const double sd = return_stddev();
+    return sd > 0 ? mean_return() / sd * std::sqrt(marks_per_year) : 0.0;
+  }
+
+  uint64_t fills() const { return fills_; }
+  uint64_t contracts() const { return contracts_; }
+  // traded value in pnl units, both sides counted
+  int64_t notional() const { return notional_; }
+
+  uint64_t round_trips() const { return round_trips_; }
+  uint64_t winners() const { return winners_; }
+  double hit_rate() const {
+    return round_trips_ ? static_cast<double>(winners_) / round_trips_ : 0.0;
+  }
+  int64_t gross_profit() const { return gross_profit_; }
+  int64_t gross_loss() const { return gross_loss_; }
+  double avg_trade_pnl() const {
+    return round_trips_
+               ? static_cast<double>(gross_profit_ + gross_loss_) / round_trips_
+               : 0.0;
+  }
+
+  // closed round trips only; an open position adds its time once flat
+  uint64_t time_in_market_ns() const { return time_in_market_ns_; }
+  uint64_t avg_holding_ns() const {
+    return round_trips_ ? time_in_market_ns_ / round_trips_ : 0;
+  }
+  uint64_t max_holding_ns() const { return max_holding_ns_; }
+
+private:
+  inline void open_trip(uint64_t time_ns) {
+    trip_open_ns_ = time_ns;
+    trip_cash_ = 0;
+  }
+
+  inline void close_trip(uint64_t time_ns) {
+    ++round_trips_;
+    if (trip_cash_ > 0) {
+      ++winners_;
+      gross_profit_ += trip_cash_;
+    } else {
+      gross_loss_ += trip_cash_;
+    }
+    const uint64_t held = time_ns - trip_open_ns_;
+    time_in_market_ns_ += held;
+    max_holding_ns_ = std::max(max_holding_ns_, held);
+  }
+
+  // marks
+  uint64_t marks_ = 0;
+  uint64_t last_mark_ns_ = 0;
+  int64_t last_pnl_ = 0;
+  int64_t peak_pnl_ = 0;
+  int64_t max_drawdown_ = 0;
+  uint64_t returns_ = 0;
+  int64_t sum_returns_ = 0;
+  __int128 sum_sq_returns_ = 0;
+
+  // fills
+  uint64_t fills_ = 0;
+  uint64_t contracts_ = 0;
+  int64_t notional_ = 0;
+  int64_t fees_ = 0;
+
+  // round trips, flat to flat
+  int position_ = 0;
+  uint64_t trip_open_ns_ = 0;
+  int64_t trip_cash_ = 0;
+  uint64_t round_trips_ = 0;
+  uint64_t winners_ = 0;
+  int64_t gross_profit_ = 0;
+  int64_t gross_loss_ = 0;
+  uint64_t time_in_market_ns_ = 0;
+  uint64_t max_holding_ns_ = 0;
+};
@@ -0,0 +1,145 @@
+#pragma once
+#include "message.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+
+// k-way merge of time sorted message streams with a loser tree. keys are
+// packed as (time_ - base) << 4 | stream, so a key is unique, ties come out
+// in stream order and every compare is a plain integer min/max that
+// compiles to cmov. each inner node holds the loser key of its subtree, and
+// the runner-up key (the best loser on the winner's path) bounds how far the
+// winning stream can run. feeds arrive in bursts, so the merge hands out
+// pre-sorted blocks: the winner's messages are scanned up to the runner-up
+// with a plain sequential compare and the tree is replayed once per block
+class StreamMerger {
+public:
+  static constexpr size_t MAX_STREAMS = 16;
+
+  explicit StreamMerger(std::span<const std::span<const book_message>> streams)
+      : streams_(streams.size()) {
+    if (streams_ == 0 || streams_ > MAX_STREAMS) {
+      throw std::runtime_error("stream merger takes 1 to 16 streams");
+    }
+    leaves_ = 1;
+    while (leaves_ < streams_) {
+      leaves_ <<= 1;
+    }
+
+    base_ = UINT64_MAX;
+    for (const auto &stream : streams) {
+      if (!stream.empty()) {
+        base_ = std::min(base_, stream.front().time_);
+      }
+    }
+
+    std::array<uint64_t, MAX_STREAMS> leaf_keys{};
+    for (uint32_t i = 0; i < leaves_; ++i) {
+      if (i < streams_) {
+        pos_[i] = streams[i].data();
+        end_[i] = streams[i].data() + streams[i].size();
+      } else {
+        pos_[i] = end_[i] = nullptr;
+      }
+      leaf_keys[i] = key_of(i);
+    }
+    winner_ = build(1, leaf_keys);
+    runner_up_ = runner_up(winner_);
+  }
+
+  // a block of consecutive messages from one stream that precede the head of
+  // every other stream; 0 once every stream is drained
+  size_t next_run(size_t &stream, const book_message *&first) {
+    const uint64_t key = winner_;
+    if (key >= EXHAUSTED) {
+      return 0;
+    }
+    const auto w = static_cast<uint32_t>(key & INDEX_MASK);
+    const book_message *p = pos_[w];
+    const book_message *const end = end_[w];
+    const uint64_t limit = runner_up_;
+    const book_message *q = p + 1;
+    while (q != end && ((q->time_ - base_) << INDEX_BITS | w) < limit) {
+      ++q;
+    }
+    pos_[w] = q;
+    stream = w;
+    first = p;
+    replay(w, key_of(w));
+    return static_cast<size_t>(q - p);
+  }
+
+  // one message at a time, served from the current block
+  bool next(size_t &stream, const book_message *&msg) {
+    if (run_pos_ == run_end_) {
+      const size_t n = next_run(run_stream_, run_pos_);
+      if (n == 0) {
+        return false;
+      }
+      run_end_ = run_pos_ + n;
+    }
+    stream = run_stream_;
+    msg = run_pos_++;
+    return true;
+  }
+
+  size_t streams() const { return streams_; }
+
+private:
+  static constexpr uint64_t INDEX_BITS = 4;
+  static constexpr uint64_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+  // above any packed time; offsets from base stay below 2^60 ns
+  static constexpr uint64_t EXHAUSTED = UINT64_MAX & ~INDEX_MASK;
+
+  void replay(uint32_t w, uint64_t key) {
+    for (uint32_t node = (w + leaves_) >> 1; node != 0; node >>= 1) {
+      const uint64_t loser = tree_[node];
+      tree_[node] = std::max(loser, key);
+      key = std::min(loser, key);
+    }
+    winner_ = key;
+    runner_up_ = runner_up(key);
+  }
+
+  uint64_t key_of(uint32_t i) const {
+    return pos_[i] != end_[i] ? (pos_[i]->time_ - base_) << INDEX_BITS | i
+                              : EXHAUSTED | i;
+  }
+
+  // the overall second is the best key that lost directly to the winner,
+  // i.e. the smallest loser on the winner's path
+  uint64_t runner_up(uint64_t winner) const {
+    const auto w = static_cast<uint32_t>(winner & INDEX_MASK);
+    uint64_t best = UINT64_MAX;
+    for (uint32_t node = (w + leaves_) >> 1; node != 0; node >>= 1) {
+      best = std::min(best, tree_[node]);
+    }
+    return best;
+  }
+
+  // returns the winner key of the subtree at node, storing losers on the
+  // way up
+  uint64_t build(uint32_t node, const std::array<uint64_t, MAX_STREAMS> &leaf) {
+    if (node >= leaves_) {
+      return leaf[node - leaves_];
+    }
+    const uint64_t l = build(node * 2, leaf);
+    const uint64_t r = build(node * 2 + 1, leaf);
+    tree_[node] = std::max(l, r);
+    return std::min(l, r);
+  }
+
+  uint32_t streams_;
+  uint32_t leaves_;
+  uint64_t base_;
+  uint64_t winner_;
+  uint64_t runner_up_;
+  size_t run_stream_ = 0;
+  const book_message *run_pos_ = nullptr;
+  const book_message *run_end_ = nullptr;
+  std::array<uint64_t, MAX_STREAMS> tree_{};
+  std::array<const book_message *, MAX_STREAMS> pos_{};
+  std::array<const book_message *, MAX_STREAMS> end_{};
+};
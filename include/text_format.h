@@ -0,0 +1,52 @@
+#pragma once
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// formatting into caller buffers that never allocates. each call returns the
+// position after what it wrote; callers size their buffers for the widest
+// line they produce
+namespace text {
+inline char *put(char *out, std::string_view s) {
+  std::memcpy(out, s.data(), s.size());
+  return out + s.size();
+}
+
+template <typename T>
+inline char *put_int(char *out, T value) {
+  return std::to_chars(out, out + 24, value).ptr;
+}
+
+inline char *put_digits(char *out, unsigned value, int width) {
+  for (int i = width - 1; i >= 0; --i) {
+    out[i] = static_cast<char>('0' + value % 10);
+    value /= 10;
+  }
+  return out + width;
+}
+
+// yyyy-mm-dd hh:mm:ss.mmm in utc
+inline char *put_time(char *out, uint64_t time_ns) {
+  using namespace std::chrono;
+  const sys_time<nanoseconds> tp{nanoseconds{time_ns}};
+  const auto day = floor<days>(tp);
+  const year_month_day ymd{day};
+  const hh_mm_ss hms{floor<milliseconds>(tp - day)};
+
+  out = put_digits(out, static_cast<unsigned>(static_cast<int>(ymd.year())), 4);
+  *out++ = '-';
+  out = put_digits(out, static_cast<unsigned>(ymd.month()), 2);
+  *out++ = '-';
+  out = put_digits(out, static_cast<unsigned>(ymd.day()), 2);
+  *out++ = ' ';
+  out = put_digits(out, static_cast<unsigned>(hms.hours().count()), 2);
+  *out++ = ':';
+  out = put_digits(out, static_cast<unsigned>(hms.minutes().count()), 2);
+  *out++ = ':';
+  out = put_digits(out, static_cast<unsigned>(hms.seconds().count()), 2);
+  *out++ = '.';
+  return put_digits(out, static_cast<unsigned>(hms.subseconds().count()), 3);
+}
+} // namespace text
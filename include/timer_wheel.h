@@ -0,0 +1,362 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class TimerHandler {
+public:
+  virtual ~TimerHandler() = default;
+  virtual void on_timer(uint64_t tag) = 0;
+};
+
+// hierarchical timer wheel on simulated time. a timer lives at the level of
+// the highest 6 bit digit in which its expiry tick differs from the current
+// tick, so every occupied slot is strictly ahead of the clock and the next
+// event is found with one ctz per level. schedule/cancel/rearm are O(1);
+// advance() is a single compare while nothing is due.
+//
+// timers never fire early: a timer with deadline d fires on the first
+// advance() at or past d rounded up to the wheel resolution. timers due on
+// the same tick fire ordered by (deadline, schedule order).
+class TimerWheel {
+public:
+  using TimerId = uint64_t;
+  static constexpr TimerId INVALID_TIMER = 0;
+
+  explicit TimerWheel(uint64_t resolution_ns = 1'000'000,
+                      size_t reserve = 4096)
+      : resolution_ns_(resolution_ns) {
+    heads_.fill(NIL);
+    occupied_.fill(0);
+    nodes_.reserve(reserve);
+    due_.reserve(64);
+  }
+
+  TimerWheel(const TimerWheel &) = delete;
+  TimerWheel &operator=(const TimerWheel &) = delete;
+
+  TimerId schedule_at(uint64_t deadline_ns, TimerHandler *handler,
+                      uint64_t tag) {
+    sync_tick();
+    uint32_t idx = acquire_node();
+    Node &n = nodes_[idx];
+    n.handler_ = handler;
+    n.tag_ = tag;
+    set_deadline(n, deadline_ns);
+    place(idx);
+    ++pending_;
+    return make_id(idx, n.gen_);
+  }
+
+  TimerId schedule_after(uint64_t delay_ns, TimerHandler *handler,
+                         uint64_t tag) {
+    return schedule_at(now_ns_ + delay_ns, handler, tag);
+  }
+
+  bool cancel(TimerId id) {
+    Node *n = lookup(id);
+    if (!n) {
+      return false;
+    }
+    const uint32_t idx = index_of(id);
+    if (n->bucket_ != DUE) {
+      unlink(idx);
+      --pending_;
+    }
+    release_node(idx);
+    return true;
+  }
+
+  // moves a pending timer to a new deadline, keeping its id. returns false
+  // if the timer already fired or was cancelled
+  bool rearm_at(TimerId id, uint64_t deadline_ns) {
+    Node *n = lookup(id);
+    if (!n || n->bucket_ == DUE) {
+      return false;
+    }
+    sync_tick();
+    const uint32_t idx = index_of(id);
+    unlink(idx);
+    set_deadline(*n, deadline_ns);
+    place(idx);
+    return true;
+  }
+
+  bool rearm_after(TimerId id, uint64_t delay_ns) {
+    return rearm_at(id, now_ns_ + delay_ns);
+  }
+
+  // called from the replay loop before each message is applied
+  inline void advance(uint64_t now_ns) {
+    if (now_ns < next_event_ns_) {
+      now_ns_ = std::max(now_ns_, now_ns);
+      return;
+    }
+    advance_slow(now_ns);
+  }
+
+  // cancels every timer. nodes are kept and their generations bumped, so an
+  // id handed out before clear() never matches a timer scheduled after it
+  void clear() {
+    free_ = NIL;
+    for (uint32_t idx = static_cast<uint32_t>(nodes_.size()); idx-- > 0;) {
+      Node &n = nodes_[idx];
+      if (n.bucket_ != FREE) {
+        ++n.gen_;
+        n.bucket_ = FREE;
+        n.handler_ = nullptr;
+      }
+      n.next_ = free_;
+      free_ = idx;
+    }
+    heads_.fill(NIL);
+    occupied_.fill(0);
+    due_.clear();
+    pending_ = 0;
+    now_ns_ = 0;
+    now_tick_ = 0;
+    next_event_tick_ = UINT64_MAX;
+    next_event_ns_ = UINT64_MAX;
+  }
+
+  uint64_t now_ns() const { return now_ns_; }
+  size_t pending() const { return pending_; }
+
+private:
+  static constexpr uint32_t NIL = UINT32_MAX;
+  static constexpr uint16_t DUE = 0xfffe;
+  static constexpr uint16_t FREE = 0xffff;
+  static constexpr int SLOT_BITS = 6;
+  static constexpr int SLOTS = 1 << SLOT_BITS;
+  static constexpr int LEVELS = (64 + SLOT_BITS - 1) / SLOT_BITS;
+
+  struct Node {
+    uint64_t deadline_ns_ = 0;
+    uint64_t expiry_tick_ = 0;
+    uint64_t seq_ = 0;
+    TimerHandler *handler_ = nullptr;
+    uint64_t tag_ = 0;
+    uint32_t prev_ = NIL;
+    uint32_t next_ = NIL;
+    uint32_t gen_ = 0;
+    uint16_t bucket_ = FREE;
+  };
+
+  uint64_t resolution_ns_;
+  uint64_t now_ns_ = 0;
+  uint64_t now_tick_ = 0;
+  uint64_t next_event_tick_ = UINT64_MAX;
+  uint64_t next_event_ns_ = UINT64_MAX;
+  uint64_t seq_ = 0;
+  size_t pending_ = 0;
+  bool advancing_ = false;
+  uint32_t free_ = NIL;
+  std::vector<Node> nodes_;
+  std::array<uint32_t, LEVELS * SLOTS> heads_;
+  std::array<uint64_t, LEVELS> occupied_;
+  std::vector<TimerId> due_;
+
+  static TimerId make_id(uint32_t idx, uint32_t gen) {
+    return (static_cast<uint64_t>(gen) << 32) | (idx + 1);
+  }
+  static uint32_t index_of(TimerId id) {
+    return static_cast<uint32_t>(id & 0xffffffffu) - 1;
+  }
+
+  Node *lookup(TimerId id) {
+    if (id == INVALID_TIMER) {
+      return nullptr;
+    }
+    const uint32_t idx = index_of(id);
+    if (idx >= nodes_.size()) {
+      return nullptr;
+    }
+    Node &n = nodes_[idx];
+    if (n.gen_ != static_cast<uint32_t>(id >> 32) || n.bucket_ == FREE) {
+      return nullptr;
+    }
+    return &n;
+  }
+
+  uint32_t acquire_node() {
+    if (free_ != NIL) {
+      uint32_t idx = free_;
+      free_ = nodes_[idx].next_;
+      return idx;
+    }
+    nodes_.emplace_back();
+    return static_cast<uint32_t>(nodes_.size() - 1);
+  }
+
+  void release_node(uint32_t idx) {
+    Node &n = nodes_[idx];
+    n.bucket_ = FREE;
+    ++n.gen_;
+    n.handler_ = nullptr;
+    n.next_ = free_;
+    free_ = idx;
+  }
+
+  void set_deadline(Node &n, uint64_t deadline_ns) {
+    n.deadline_ns_ = deadline_ns;
+    n.expiry_tick_ = std::max(
+        now_tick_, (deadline_ns + resolution_ns_ - 1) / resolution_ns_);
+    n.seq_ = seq_++;
+  }
+
+  // bring now_tick_ up to now_ns_ before inserting. safe because
+  // next_event_tick_ never overstates the next occupied slot, and the fast
+  // path only lets now_ns_ run ahead while it is below that tick
+  void sync_tick() {
+    if (advancing_) {
+      return;
+    }
+    now_tick_ = std::max(now_tick_, now_ns_ / resolution_ns_);
+  }
+
+  void place(uint32_t idx) {
+    Node &n = nodes_[idx];
+    const uint64_t diff = n.expiry_tick_ ^ now_tick_;
+    const int level = diff ? (63 - __builtin_clzll(diff)) / SLOT_BITS : 0;
+    const int shift = level * SLOT_BITS;
+    const int slot = static_cast<int>((n.expiry_tick_ >> shift) & (SLOTS - 1));
+    const uint16_t bucket = static_cast<uint16_t>(level * SLOTS + slot);
+
+    n.bucket_ = bucket;
+    n.prev_ = NIL;
+    n.next_ = heads_[bucket];
+    if (n.next_ != NIL) {
+      nodes_[n.next_].prev_ = idx;
+    }
+    heads_[bucket] = idx;
+    occupied_[level] |= 1ull << slot;
+
+    const uint64_t event_tick =
+        shift ? (n.expiry_tick_ >> shift) << shift : n.expiry_tick_;
+    if (event_tick < next_event_tick_) {
+      next_event_tick_ = event_tick;
+      next_event_ns_ = event_ns(event_tick);
+    }
+  }
+
+  void unlink(uint32_t idx) {
+    Node &n = nodes_[idx];
+    const uint16_t bucket = n.bucket_;
+    if (n.prev_ != NIL) {
+      nodes_[n.prev_].next_ = n.next_;
+    } else {
+      heads_[bucket] = n.next_;
+    }
+    if (n.next_ != NIL) {
+      nodes_[n.next_].prev_ = n.prev_;
+    }
+    if (heads_[bucket] == NIL) {
+      occupied_[bucket / SLOTS] &= ~(1ull << (bucket % SLOTS));
+    }
+  }
+
+  uint64_t event_ns(uint64_t tick) const {
+    return tick > UINT64_MAX / resolution_ns_ ? UINT64_MAX
+                                              : tick * resolution_ns_;
+  }
+
+  // first tick after now_tick_ at which a slot fires or cascades, and the
+  // level it belongs to. lower levels always win since their candidates lie
+  // inside the current block of the level above
+  uint64_t next_event_tick(int &level) const {
+    for (int l = 0; l < LEVELS; ++l) {
+      const int shift = l * SLOT_BITS;
+      const int digit = static_cast<int>((now_tick_ >> shift) & (SLOTS - 1));
+      const uint64_t ahead = digit == SLOTS - 1 ? 0 : ~0ull << (digit + 1);
+      const uint64_t mask = occupied_[l] & ahead;
+      if (!mask) {
+        continue;
+      }
+      level = l;
+      const int upper = shift + SLOT_BITS;
+      const uint64_t base = upper >= 64 ? 0 : (now_tick_ >> upper) << upper;
+      return base | (static_cast<uint64_t>(__builtin_ctzll(mask)) << shift);
+    }
+    return UINT64_MAX;
+  }
+
+  uint32_t take_bucket(uint16_t bucket) {
+    uint32_t head = heads_[bucket];
+    heads_[bucket] = NIL;
+    occupied_[bucket / SLOTS] &= ~(1ull << (bucket % SLOTS));
+    return head;
+  }
+
+  void fire_current_tick() {
+    const uint16_t bucket = static_cast<uint16_t>(now_tick_ & (SLOTS - 1));
+    while (heads_[bucket] != NIL) {
+      due_.clear();
+      for (uint32_t idx = take_bucket(bucket); idx != NIL;) {
+        Node &n = nodes_[idx];
+        const uint32_t next = n.next_;
+        n.bucket_ = DUE;
+        due_.push_back(make_id(idx, n.gen_));
+        --pending_;
+        idx = next;
+      }
+      std::sort(due_.begin(), due_.end(), [this](TimerId a, TimerId b) {
+        const Node &x = nodes_[index_of(a)];
+        const Node &y = nodes_[index_of(b)];
+        return x.deadline_ns_ != y.deadline_ns_
+                   ? x.deadline_ns_ < y.deadline_ns_
+                   : x.seq_ < y.seq_;
+      });
+      // handlers may schedule or cancel, including timers in this batch
+      for (size_t i = 0; i < due_.size(); ++i) {
+        const TimerId id = due_[i];
+        Node *n = lookup(id);
+        if (!n) {
+          continue;
+        }
+        TimerHandler *handler = n->handler_;
+        const uint64_t tag = n->tag_;
+        release_node(index_of(id));
+        handler->on_timer(tag);
+      }
+    }
+  }
+
+  void advance_slow(uint64_t now_ns) {
+    now_ns_ = std::max(now_ns_, now_ns);
+    const uint64_t target = now_ns_ / resolution_ns_;
+    next_event_tick_ = UINT64_MAX;
+    next_event_ns_ = UINT64_MAX;
+    advancing_ = true;
+
+    for (;;) {
+      fire_current_tick();
+      if (now_tick_ >= target) {
+        break;
+      }
+      int level = 0;
+      const uint64_t next = pending_ ? next_event_tick(level) : UINT64_MAX;
+      if (next > target) {
+        now_tick_ = target;
+        break;
+      }
+      now_tick_ = next;
+      if (level == 0) {
+        continue;
+      }
+      const int shift = level * SLOT_BITS;
+      const uint16_t bucket = static_cast<uint16_t>(
+          level * SLOTS + ((now_tick_ >> shift) & (SLOTS - 1)));
+      for (uint32_t idx = take_bucket(bucket); idx != NIL;) {
+        const uint32_t next_idx = nodes_[idx].next_;
+        place(idx);
+        idx = next_idx;
+      }
+    }
+
+    advancing_ = false;
+    int level = 0;
+    next_event_tick_ = pending_ ? next_event_tick(level) : UINT64_MAX;
+    next_event_ns_ = event_ns(next_event_tick_);
+  }
+};
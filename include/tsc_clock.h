@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// time stamp counter reads for timing short sections. start() and stop()
+// are fenced so the timed instructions can not drift out of the interval.
+// without a tsc, ticks are steady_clock nanoseconds
+struct TscClock {
+  __attribute__((always_inline))
+  static uint64_t start() {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    const uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+#else
+    return steady_ns();
+#endif
+  }
+
+  __attribute__((always_inline))
+  static uint64_t stop() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned aux;
+    const uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+#else
+    return steady_ns();
+#endif
+  }
+
+  // measured once, on first use, against steady_clock over a 20 ms spin
+  static double ns_per_tick() {
+    static const double ratio = calibrate();
+    return ratio;
+  }
+
+  static double to_ns(uint64_t ticks) { return ticks * ns_per_tick(); }
+
+private:
+  static uint64_t steady_ns() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+  }
+
+  static double calibrate() {
+#if defined(__x86_64__) || defined(__i386__)
+    const uint64_t ns0 = steady_ns();
+    const uint64_t t0 = start();
+    uint64_t ns1;
+    do {
+      ns1 = steady_ns();
+    } while (ns1 - ns0 < 20'000'000);
+    const uint64_t t1 = stop();
+    return t1 > t0 ? static_cast<double>(ns1 - ns0) / (t1 - t0) : 1.0;
+#else
+    return 1.0;
+#endif
+  }
+};
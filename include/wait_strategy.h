@@ -0,0 +1,118 @@
+#pragma once
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+// how a queue consumer waits for work. every mode spins first; after that
+// BUSY_SPIN keeps spinning, SPIN_YIELD hands the core to the scheduler between
+// checks and SPIN_PARK sleeps on a futex until a producer wakes it. producers
+// call notify() after publishing, which only costs a syscall while the
+// consumer is actually parked
+enum class WaitMode { BUSY_SPIN, SPIN_YIELD, SPIN_PARK };
+
+class WaitStrategy {
+public:
+  static constexpr uint32_t DEFAULT_SPINS = 2000;
+  static constexpr uint32_t YIELDS_BEFORE_PARK = 16;
+
+  explicit WaitStrategy(WaitMode mode = WaitMode::SPIN_PARK,
+                        uint32_t spins = DEFAULT_SPINS)
+      : mode_(mode), spins_(spins) {}
+
+  WaitStrategy(const WaitStrategy &) = delete;
+  WaitStrategy &operator=(const WaitStrategy &) = delete;
+
+  // consumer side: returns once ready() is true. ready() must also turn true
+  // on shutdown, and shutdown must call wake()
+  template <typename Ready>
+  void wait(Ready &&ready) {
+    for (uint32_t i = 0; i < spins_; ++i) {
+      if (ready()) {
+        return;
+      }
+      __builtin_ia32_pause();
+    }
+    switch (mode_) {
+    case WaitMode::BUSY_SPIN:
+      while (!ready()) {
+        __builtin_ia32_pause();
+      }
+      return;
+    case WaitMode::SPIN_YIELD:
+      while (!ready()) {
+        std::this_thread::yield();
+      }
+      return;
+    case WaitMode::SPIN_PARK:
+      for (uint32_t i = 0; i < YIELDS_BEFORE_PARK; ++i) {
+        if (ready()) {
+          return;
+        }
+        std::this_thread::yield();
+      }
+      while (!ready()) {
+        park(ready);
+      }
+      return;
+    }
+  }
+
+  // producer side, after the item is visible to the consumer
+  __attribute__((always_inline))
+  void notify() {
+    if (mode_ != WaitMode::SPIN_PARK) {
+      return;
+    }
+    // pairs with the fence in park(): either the consumer sees the item on
+    // its last check or this load sees it parked
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // the exchange keeps a burst of items to one wake per park
+    if (parked_.load(std::memory_order_relaxed) &&
+        parked_.exchange(false, std::memory_order_relaxed)) {
+      wake();
+    }
+  }
+
+  // unconditional, for shutdown
+  void wake() {
+    epoch_.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch_),
+            FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+  }
+
+  WaitMode mode() const { return mode_; }
+  // only while no thread waits on or notifies this strategy: a producer
+  // that still sees the old mode would skip the wake a parked consumer needs
+  void set_mode(WaitMode mode) { mode_ = mode; }
+  uint64_t parks() const { return parks_.load(std::memory_order_relaxed); }
+
+private:
+  template <typename Ready>
+  void park(Ready &ready) {
+    // a wake() after this load changes the epoch, so the futex wait below
+    // returns at once instead of sleeping through it
+    const uint32_t epoch = epoch_.load(std::memory_order_acquire);
+    parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!ready()) {
+      parks_.fetch_add(1, std::memory_order_relaxed);
+      syscall(SYS_futex, reinterpret_cast<uint32_t *>(&epoch_),
+              FUTEX_WAIT_PRIVATE, epoch, nullptr, nullptr, 0);
+    }
+    parked_.store(false, std::memory_order_relaxed);
+  }
+
+  WaitMode mode_;
+  const uint32_t spins_;
+
+  // written by the consumer, read by every notify()
+  alignas(64) std::atomic<bool> parked_{false};
+  std::atomic<uint64_t> parks_{0};
+  alignas(64) std::atomic<uint32_t> epoch_{0};
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
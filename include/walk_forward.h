@@ -0,0 +1,66 @@
+#pragma once
+#include "feature_store.h"
+#include "message.h"
+#include "message_store.h"
+#include "regression_grid.h"
+#include "signal_eval.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct WalkForwardConfig {
+  std::string instrument_id_;
+  // one data file per day, in date order
+  std::vector<std::string> files_;
+  size_t train_days_ = 5;
+  int max_lag_ = 5;
+  int horizon_ = 60;
+  uint64_t bar_interval_ns_ = 1'000'000'000;
+  // every threshold is tested against the same fitted model
+  std::vector<double> thresholds_;
+  int max_position_ = 1;
+  int32_t point_value_ = 1;
+  int32_t fees_per_side_ = 1;
+};
+
+struct WalkForwardDay {
+  std::string file_;
+  GridFit fit_;
+  size_t test_rows_ = 0;
+  std::vector<SignalResult> results_;
+};
+
+// train on days [d - k, d), test on d, roll forward. each day is replayed
+// once: its feature columns feed both the test of that day and the gram
+// stats that the next k windows sum, so overlapping windows share the
+// extraction. while day d is evaluated, day d + 1 is loaded and extracted
+// and its model is fitted on other cores
+class WalkForward {
+public:
+  using Loader = std::function<std::shared_ptr<const MessageStore>(
+      const std::string &file)>;
+
+  WalkForward(WalkForwardConfig config, Loader loader,
+              std::shared_ptr<const FeatureStore> store = nullptr);
+
+  // one entry per tested day, i.e. files_.size() - train_days_ of them
+  std::vector<WalkForwardDay> run();
+
+private:
+  struct PreparedDay {
+    FeatureFrame frame_;
+    GridStats stats_;
+  };
+
+  // prepares run one after another, so they share one scratch book
+  PreparedDay prepare(size_t day);
+  GridFit fit_window(const std::vector<GridStats> &window) const;
+
+  WalkForwardConfig config_;
+  Loader loader_;
+  std::shared_ptr<const FeatureStore> store_;
+  FeatureSpec spec_;
+  RegressionGrid grid_;
+  std::unique_ptr<Orderbook> scratch_;
+};
@@ -1,150 +1,300 @@
 #include "../include/backtester.h"
 #include "strategies/imbalance_strat.cpp"
 #include "strategies/linear_model_strat.cpp"
+#include <chrono>
 
-Backtester::Backtester(std::shared_ptr<ConnectionPool> pool,
-                       const std::string &instrument_id,
-                       const std::vector<book_message> &&messages,
-                       const std::vector<book_message> &&train_messages)
-    : connection_pool_(pool), instrument_id_(instrument_id),
-      messages_(std::move(messages)),
-      train_messages_(std::move(train_messages)), first_update_(false),
+namespace {
+// session times in the data files are us/eastern; convert to utc epoch ns so
+// the replay loop compares integers against book_message::time_
+uint64_t session_time_ns(int y, unsigned m, unsigned d, int hour, int minute) {
+  using namespace std::chrono;
+  const sys_days day{year{y} / month{m} / std::chrono::day{d}};
+  const sys_days dst_start{year{y} / March / Sunday[2]};
+  const sys_days dst_end{year{y} / November / Sunday[1]};
+  const int utc_offset = (day >= dst_start && day < dst_end) ? 4 : 5;
+  const auto tp = day + hours{hour + utc_offset} + minutes{minute};
+  return static_cast<uint64_t>(
+      duration_cast<nanoseconds>(tp.time_since_epoch()).count());
+}
+} // namespace
+
+Backtester::Backtester(LogConfig logging, const std::string &instrument_id,
+                       std::shared_ptr<const MessageStore> messages,
+                       std::shared_ptr<const MessageStore> train_messages)
+    : logging_(std::move(logging)), instrument_id_(instrument_id),
+      message_store_(std::move(messages)),
+      train_store_(std::move(train_messages)), first_update_(false),
       current_message_index_(0), train_message_index_(0), running_(false) {
   book_ = std::make_unique<Orderbook>(100, 7000000);
   train_book_ = std::make_unique<Orderbook>(100, 7000000);
+  if (message_store_) {
+    messages_ = message_store_->messages();
+  }
+  if (train_store_) {
+    train_messages_ = train_store_->messages();
+  }
 }
 
 Backtester::~Backtester() { stop_backtest(); }
 
 void Backtester::create_strategy(size_t strategy_index) {
+  scheduler_.shutdown();
+  timers_.clear();
+  samplers_.clear();
   strategy_ = nullptr;
   switch (strategy_index) {
   case 0:
-    strategy_ = std::make_unique<ImbalanceStrat>(connection_pool_,
-                                                 instrument_id_, book_.get());
+    strategy_ = std::make_unique<ImbalanceStrat>(logging_, instrument_id_,
+                                                 book_.get());
     break;
   case 1:
     strategy_ = std::make_unique<LinearModelStrategy>(
-        connection_pool_, instrument_id_, book_.get());
+        logging_, instrument_id_, book_.get());
+    break;
+  case 2:
+    strategy_ = std::make_unique<LinearModelStrategy>(
+        logging_, instrument_id_, book_.get(), true);
     break;
   default:
     throw std::runtime_error("unknown strategy index: " +
                              std::to_string(strategy_index));
   }
+
+  strategy_->subscribe(samplers_);
+  // added after the strategy's own samplers, so each mark sees the pnl the
+  // strategy just recomputed on that bar
+  samplers_.add<TimeSampler>(Strategy::BAR_INTERVAL_NS)
+      .subscribe([this](const Bar &bar) {
+        mark(bar.close_time_, bar.bid_, bar.ask_);
+      });
+  strategy_->attach_timers(&timers_);
+  strategy_->attach_scheduler(&scheduler_);
+}
+
+bool Backtester::session_window(const std::string &filename,
+                                uint64_t &start_ns, uint64_t &end_ns) {
+  // filenames look like es0802.csv
+  if (filename.length() < 8)
+    return false;
+  unsigned month = std::stoul(filename.substr(2, 2));
+  unsigned day = std::stoul(filename.substr(4, 2));
+  start_ns = session_time_ns(2024, month, day, 9, 30);
+  end_ns = session_time_ns(2024, month, day, 16, 0);
+  return true;
 }
 
 void Backtester::set_trading_times(const std::string &backtest_file,
                                    const std::string &train_file) {
-  auto extract_date = [](const std::string &filename) -> std::string {
-    if (filename.length() < 8)
-      return "";
-    std::string month = filename.substr(2, 2);
-    std::string day = filename.substr(4, 2);
-    return "2024-" + month + "-" + day;
-  };
-
-  std::string backtest_date = extract_date(backtest_file);
-  if (!backtest_date.empty()) {
-    start_time_ = backtest_date + " 09:30:00.000";
-    end_time_ = backtest_date + " 16:00:00.000";
-  }
-
+  current_day_.file_ = backtest_file;
+  session_window(backtest_file, start_ns_, end_ns_);
   if (!train_file.empty()) {
-    std::string train_date = extract_date(train_file);
-    if (!train_date.empty()) {
-      train_start_time_ = train_date + " 09:30:00.000";
-      train_end_time_ = train_date + " 16:00:00.000";
-    }
+    session_window(train_file, train_start_ns_, train_end_ns_);
   }
 }
 
 void Backtester::train_model() {
-  train_message_index_ = 0;
-  int64_t prev_seconds = 0;
+  const FeatureSpec spec = FeatureSpec::time_bars(
+      Strategy::BAR_INTERVAL_NS,
+      feature_bit(Feature::VOI) | feature_bit(Feature::MID));
 
-  auto parse_time = [](const std::string &time_str) {
-    int hour = (time_str[11] - '0') * 10 + (time_str[12] - '0');
-    int minute = (time_str[14] - '0') * 10 + (time_str[15] - '0');
-    int second = (time_str[17] - '0') * 10 + (time_str[18] - '0');
-    return hour * 3600 + minute * 60 + second;
-  };
+  // a cache hit maps the columns and skips the replay entirely
+  const FeatureFrame train =
+      feature_store_
+          ? feature_store_->load_or_extract(
+                train_store_ ? train_store_->hash()
+                             : FeatureStore::hash_messages(train_messages_),
+                train_messages_, train_start_ns_, train_end_ns_, spec,
+                *train_book_)
+          : FeatureStore().extract(train_messages_, train_start_ns_,
+                                   train_end_ns_, spec, *train_book_);
+  train_message_index_ = train_messages_.size();
 
-  while (train_message_index_ < train_messages_.size()) {
-    const auto &msg = train_messages_[train_message_index_];
-    train_book_->process_msg(msg);
+  if (strategy_->requires_fitting()) {
+    strategy_->fit_model(train);
+  }
+}
 
-    std::string curr_time = train_book_->get_formatted_time_fast();
-    int64_t curr_seconds = parse_time(curr_time);
+void Backtester::attach_features() {
+  const uint32_t columns = strategy_->feature_columns();
+  // features are extracted from an empty book, so they only describe a day
+  // replayed without an opening snapshot
+  if (!columns || !feature_store_ || !message_store_ || opening_) {
+    return;
+  }
+  // extracted with the strategy's own bar cadence and the same
+  // process-then-sample order as the replay loop, so rows line up with bars.
+  // train_book_ is done with once the model is fit and serves as scratch
+  const FeatureSpec spec =
+      FeatureSpec::time_bars(Strategy::BAR_INTERVAL_NS, columns);
+  train_book_->clear();
+  strategy_->attach_features(feature_store_->load_or_extract(
+      message_store_->hash(), messages_, start_ns_, end_ns_, spec,
+      *train_book_));
+}
 
-    if (curr_time >= train_start_time_) {
-      if (prev_seconds == 0) {
-        prev_seconds = curr_seconds;
-      }
+void Backtester::set_feature_store(std::shared_ptr<const FeatureStore> store) {
+  feature_store_ = std::move(store);
+}
 
-      if (curr_seconds - prev_seconds >= 1) {
-        train_book_->calculate_voi();
-        train_book_->add_mid_price();
-        prev_seconds = curr_seconds;
-      }
-    }
+void Backtester::set_flatten_at_close(bool flatten) {
+  flatten_at_close_ = flatten;
+}
 
-    ++train_message_index_;
+void Backtester::set_opening_snapshot(
+    std::shared_ptr<const BookSnapshot> snapshot) {
+  opening_ = std::move(snapshot);
+}
 
-    if (curr_time >= train_end_time_) {
-      break;
-    }
-  }
+void Backtester::set_result_cache(std::shared_ptr<const ResultCache> cache) {
+  result_cache_ = std::move(cache);
+}
 
-  book_->voi_history_ = std::move(train_book_->voi_history_);
-  book_->mid_prices_ = std::move(train_book_->mid_prices_);
+void Backtester::set_portfolio(PortfolioAggregator::Producer *producer) {
+  portfolio_ = producer;
+}
 
-  if (strategy_->requires_fitting()) {
-    strategy_->fit_model();
+void Backtester::finish_portfolio() {
+  if (portfolio_) {
+    portfolio_->finish();
   }
 }
 
+DayResult Backtester::day_result() const { return result_.summary_; }
+
+ResultKey Backtester::result_key() const {
+  ResultKey key;
+  key.data_hash_ = message_store_ ? message_store_->hash() : 0;
+  key.train_hash_ = train_store_ ? train_store_->hash() : 0;
+  key.opening_hash_ = opening_ ? opening_->hash_ : 0;
+  key.start_ns_ = start_ns_;
+  key.end_ns_ = end_ns_;
+  key.train_start_ns_ = train_start_ns_;
+  key.train_end_ns_ = train_end_ns_;
+  key.flatten_at_close_ = flatten_at_close_;
+  key.strategy_ = strategy_->name_;
+  key.params_ = strategy_->params();
+  key.version_ = strategy_->version();
+  return key;
+}
+
 void Backtester::start_backtest() {
-  if (!running_) {
-    running_ = true;
+  if (running_) {
+    return;
+  }
+  running_ = true;
+
+  if (!result_cache_) {
     run_backtest();
+    return;
+  }
+
+  const ResultKey key = result_key();
+  if (auto cached = result_cache_->open(key)) {
+    result_ = std::move(*cached);
+    result_.summary_.file_ = current_day_.file_;
+    if (portfolio_) {
+      for (const auto &point : result_.pnl_curve_) {
+        portfolio_->mark(point.time_, point.pnl_, point.position_,
+                         point.price_, result_.summary_.point_value_);
+      }
+    }
+    running_ = false;
+    return;
+  }
+
+  // a stopped run is partial and must not answer for the whole session
+  if (run_backtest()) {
+    try {
+      result_cache_->save(key, result_);
+    } catch (const std::exception &e) {
+      std::cerr << "result cache write failed: " << e.what() << std::endl;
+    }
   }
 }
 
 void Backtester::stop_backtest() { running_ = false; }
 
-void Backtester::run_backtest() {
-  auto parse_time = [](const std::string &time_str) {
-    int hour = (time_str[11] - '0') * 10 + (time_str[12] - '0');
-    int minute = (time_str[14] - '0') * 10 + (time_str[15] - '0');
-    int second = (time_str[17] - '0') * 10 + (time_str[18] - '0');
-    return hour * 3600 + minute * 60 + second;
-  };
+bool Backtester::run_backtest() {
+  attach_features();
+  FrameArena::Scope arena_scope(scheduler_.arena());
+  strategy_->spawn_tasks();
+  result_ = BacktestResult{};
+  bool session_open = false;
 
-  int64_t prev_seconds = 0;
+  if (opening_ && current_message_index_ == 0) {
+    for (const auto &order : opening_->orders_) {
+      book_->process_msg(order);
+    }
+  }
 
   while (running_ && current_message_index_ < messages_.size()) {
     const auto &msg = messages_[current_message_index_];
+    timers_.advance(msg.time_);
     book_->process_msg(msg);
-    std::string curr_time = book_->get_formatted_time_fast();
-   // std::cout << curr_time << std::endl;
-    int64_t curr_seconds = parse_time(curr_time);
-    if (curr_time >= start_time_) {
-      if (prev_seconds == 0) {
-        prev_seconds = curr_seconds;
+    if (msg.time_ >= start_ns_) {
+      if (!session_open) {
+        session_open = true;
+        result_.summary_.open_bid_ = book_->get_best_bid_price();
+        result_.summary_.open_ask_ = book_->get_best_ask_price();
       }
-      if (curr_seconds - prev_seconds >= 1) {
-        strategy_->on_book_update();
-        prev_seconds = curr_seconds;
+      samplers_.on_message(msg, *book_);
+      scheduler_.on_message();
+      if (!strategy_->trade_queue_.empty()) {
+        drain_trades(msg.time_);
       }
     }
-    if (curr_time >= end_time_) {
-      strategy_->close_positions();
+    if (msg.time_ >= end_ns_) {
+      if (flatten_at_close_) {
+        strategy_->close_positions();
+        drain_trades(msg.time_);
+      }
+      mark(msg.time_, book_->get_best_bid_price(),
+           book_->get_best_ask_price());
       break;
     }
     ++current_message_index_;
   }
 
+  DayResult &day = result_.summary_;
+  day.file_ = current_day_.file_;
+  day.pnl_ = strategy_->get_pnl();
+  day.position_ = strategy_->get_position();
+  day.point_value_ = strategy_->get_point_value();
+  day.close_bid_ = book_->get_best_bid_price();
+  day.close_ask_ = book_->get_best_ask_price();
+  day.messages_ = current_message_index_;
+  result_.metrics_ = strategy_->metrics();
+
+  const bool completed = running_;
+  scheduler_.shutdown();
   running_ = false;
+  return completed;
+}
+
+void Backtester::drain_trades(uint64_t time) {
+  auto &queue = strategy_->trade_queue_;
+  int32_t last_price = 0;
+  while (!queue.empty()) {
+    const auto [is_buy, price] = queue.front();
+    queue.pop();
+    result_.trades_.push_back({time, price, is_buy ? 1 : -1});
+    last_price = price;
+  }
+  if (portfolio_ && last_price) {
+    portfolio_->fill(time, strategy_->get_position(), last_price,
+                     strategy_->get_point_value());
+  }
+}
+
+void Backtester::mark(uint64_t time, int32_t bid, int32_t ask) {
+  strategy_->mark(time);
+  const PnlPoint point{time, strategy_->get_pnl(), strategy_->get_position(),
+                       (bid + ask) / 2};
+  result_.pnl_curve_.push_back(point);
+  if (portfolio_) {
+    portfolio_->mark(point.time_, point.pnl_, point.position_, point.price_,
+                     strategy_->get_point_value());
+  }
 }
 
 void Backtester::reset_state() {
@@ -152,12 +302,19 @@ void Backtester::reset_state() {
   current_message_index_ = 0;
   train_message_index_ = 0;
   first_update_ = false;
-  book_.reset();
+  samplers_.reset();
+  scheduler_.shutdown();
+  timers_.clear();
+  // the strategy keeps a pointer to book_, so clear in place rather than
+  // rebuild; clearing keeps the pools and index pages warm
+  book_->clear();
+  train_book_->clear();
 
-  train_book_.reset();
+  result_ = BacktestResult{};
 
   if (strategy_) {
     strategy_->reset();
+    strategy_->trade_queue_ = {};
   }
 }
 
@@ -166,7 +323,7 @@ void Backtester::run_multiday_backtest() {
     current_day_ = std::move(trading_days_.front());
     trading_days_.pop();
 
-    start_time_ = current_day_.start_time_;
-    end_time_ = current_day_.end_time_;
+    start_ns_ = current_day_.start_ns_;
+    end_ns_ = current_day_.end_ns_;
   }
 }
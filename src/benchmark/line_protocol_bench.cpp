@@ -0,0 +1,165 @@
+#include "../../include/db_connection.h"
+#include "../../include/line_protocol.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <random>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+constexpr size_t RECORDS = 1'000'000;
+
+// stands in for the database: accepts one connection on an ephemeral
+// loopback port and keeps every byte it is sent until the peer closes
+class StandInServer {
+public:
+  StandInServer() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    if (listen_fd_ < 0 ||
+        bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), len) < 0 ||
+        listen(listen_fd_, 1) < 0 ||
+        getsockname(listen_fd_, reinterpret_cast<sockaddr *>(&addr), &len) <
+            0) {
+      throw std::runtime_error("stand-in server: " +
+                               std::string(strerror(errno)));
+    }
+    port_ = ntohs(addr.sin_port);
+    thread_ = std::thread([this] {
+      const int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      char chunk[1 << 16];
+      ssize_t n;
+      while ((n = read(fd, chunk, sizeof(chunk))) > 0) {
+        received_.append(chunk, static_cast<size_t>(n));
+      }
+      close(fd);
+    });
+  }
+
+  ~StandInServer() {
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    close(listen_fd_);
+  }
+
+  int port() const { return port_; }
+
+  // valid once the client has closed its connection
+  const std::string &received() {
+    thread_.join();
+    return received_;
+  }
+
+private:
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::thread thread_;
+  std::string received_;
+};
+
+std::vector<LogRecord> make_records() {
+  std::mt19937_64 rng(7);
+  std::uniform_int_distribution<int32_t> price(1'900'000, 2'100'000);
+  std::uniform_int_distribution<int64_t> pnl(-5'000'000, 5'000'000);
+  std::vector<LogRecord> records;
+  records.reserve(RECORDS);
+  uint64_t t = 1'722'605'400'000'000'000;
+  for (size_t i = 0; i < RECORDS; ++i) {
+    const int32_t bid = price(rng);
+    t += 1 + rng() % 100'000;
+    records.push_back(LogRecord{t, pnl(rng), bid, bid + 250,
+                                static_cast<int32_t>(rng() % 3) - 1,
+                                static_cast<int32_t>(i), 0});
+  }
+  return records;
+}
+
+struct Run {
+  double seconds_;
+  uint64_t writes_;
+  bool exact_;
+};
+
+// time until the stand-in has every byte, and whether they are the expected
+template <typename Send>
+Run run(const std::vector<LogRecord> &records, const std::string &expected,
+        Send send) {
+  StandInServer server;
+  uint64_t writes;
+  const auto start = std::chrono::steady_clock::now();
+  {
+    auto connection =
+        std::make_unique<Connection>("127.0.0.1", server.port(), "bench");
+    send(*connection, records);
+    while (connection->bytes_sent() < expected.size()) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    writes = connection->writes();
+  }
+  const std::string &received = server.received();
+  const auto end = std::chrono::steady_clock::now();
+  return {std::chrono::duration<double>(end - start).count(), writes,
+          received == expected};
+}
+
+void report(const char *name, const Run &r, size_t bytes) {
+  std::cout << name << ": " << RECORDS / r.seconds_ / 1e6 << " M lines/s, "
+            << bytes / r.seconds_ / 1e6 << " MB/s, " << r.writes_
+            << " writes, " << (r.exact_ ? "byte exact" : "OUTPUT MISMATCH")
+            << "\n";
+}
+} // namespace
+
+// lines and bytes per second into a local stand-in for the database, one
+// send per line against batched encoding with gathered writes
+int main() {
+  const auto records = make_records();
+
+  std::string expected;
+  char line[LineProtocolBatch::MAX_LINE];
+  for (const auto &record : records) {
+    expected.append(line, LineProtocolBatch::encode(line, "nq", record));
+  }
+
+  const Run per_line = run(records, expected, [](Connection &c, const auto &rs) {
+    char buf[LineProtocolBatch::MAX_LINE];
+    for (const auto &record : rs) {
+      const std::string line(buf, LineProtocolBatch::encode(buf, "nq", record));
+      while (!c.send_trade_log(line)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  report("line per send", per_line, expected.size());
+
+  // the path LogService takes: encode into a batch, hand full batches over
+  const Run batched = run(records, expected, [](Connection &c, const auto &rs) {
+    LineProtocolBatch batch;
+    for (const auto &record : rs) {
+      batch.append("nq", record);
+      if (batch.due()) {
+        std::string full = batch.take(c.spare_buffer());
+        while (!c.send_batch(std::move(full))) {
+          std::this_thread::yield();
+        }
+      }
+    }
+    c.send_batch(batch.take());
+  });
+  report("batched", batched, expected.size());
+  return 0;
+}
@@ -1,23 +1,78 @@
 #include "../../include/market_data_ingestor.h"
+#include "../../include/perf_counters.h"
 #include "../parser.cpp"
+#include <cstring>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
 
-int main() {
+namespace {
+// totals and per message counts of one phase, n/a where a counter could
+// not be opened
+void print_counters(const char *phase, const PerfCounters::Sample &sample,
+                    size_t messages) {
+  std::cout << phase << " counters (" << messages << " messages)\n";
+  for (int e = 0; e < PerfCounters::EVENTS; ++e) {
+    const auto event = static_cast<PerfCounters::Event>(e);
+    std::cout << "  " << std::left << std::setw(15) << PerfCounters::NAMES[e]
+              << std::right;
+    if (!sample.valid(event)) {
+      std::cout << std::setw(16) << "n/a" << '\n';
+      continue;
+    }
+    std::cout << std::setw(16) << sample.value(event) << std::setw(12)
+              << std::fixed << std::setprecision(3)
+              << static_cast<double>(sample.value(event)) /
+                     std::max<size_t>(messages, 1)
+              << " / msg\n";
+  }
+  if (sample.valid(PerfCounters::CYCLES) &&
+      sample.valid(PerfCounters::INSTRUCTIONS) &&
+      sample.value(PerfCounters::CYCLES) > 0) {
+    std::cout << "  IPC " << std::setprecision(2)
+              << static_cast<double>(sample.value(PerfCounters::INSTRUCTIONS)) /
+                     sample.value(PerfCounters::CYCLES)
+              << '\n';
+  }
+}
+} // namespace
+
+// --latency times every message into per action and side histograms and
+// writes them to ingest_latency.csv. hardware counters are read around the
+// parse and around the replay wherever perf_event_open allows it
+int main(int argc, char **argv) {
   try {
+    bool latency = false;
+    for (int i = 1; i < argc; ++i) {
+      latency |= std::strcmp(argv[i], "--latency") == 0;
+    }
+
     const std::filesystem::path data_file =
         std::filesystem::current_path() / ".." / ".." / "data" / "es0801.csv";
 
+    PerfCounters counters;
+    if (!counters.available()) {
+      std::cout << "hardware counters unavailable (" << counters.error()
+                << "), reporting wall time only" << std::endl;
+    } else if (!counters.error().empty()) {
+      std::cout << "some counters unavailable (" << counters.error() << ")"
+                << std::endl;
+    }
+
     std::cout << "Parsing " << data_file << "..." << std::endl;
     auto parser = std::make_unique<Parser>(data_file.string());
+    counters.start();
     parser->parse();
-    int32_t min_px = INT32_MAX, max_px = INT32_MIN;
+    const auto parse_counts = counters.stop();
+    const size_t messages = parser->message_stream_.size();
 
-    std::cout << "Creating ingester with " << parser->message_stream_.size()
-              << " messages..." << std::endl;
+    std::cout << "Creating ingester with " << messages << " messages..."
+              << std::endl;
 
-    MarketDataIngestor ingester(std::move(parser->message_stream_));
+    MarketDataIngestor ingester(std::move(parser->message_stream_), latency);
+    ingester.count_events(counters.available());
     ingester.start();
 
     while (!ingester.is_completed()) {
@@ -26,6 +81,16 @@ int main() {
 
     ingester.stop();
     ingester.print_performance_stats();
+    if (counters.available()) {
+      print_counters("parse", parse_counts, messages);
+      print_counters("replay", ingester.event_counts(),
+                     ingester.get_messages_processsed());
+    }
+    if (latency) {
+      ingester.print_latency_stats();
+      std::ofstream out("ingest_latency.csv");
+      ingester.dump_latency_histograms(out);
+    }
 
     return 0;
 
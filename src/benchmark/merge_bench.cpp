@@ -0,0 +1,90 @@
+#include "../../include/stream_merge.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+constexpr size_t MESSAGES_PER_STREAM = 2'000'000;
+
+// bursty streams look like real mbo feeds: an event fans out into several
+// messages sharing one timestamp. burst 1 is the worst case, independent
+// poisson arrivals interleaving on almost every message
+std::vector<book_message> make_stream(std::mt19937_64 &rng, double burst) {
+  std::exponential_distribution<double> gap(1.0 / 500.0);
+  std::geometric_distribution<int> extra(1.0 / burst);
+  std::vector<book_message> stream;
+  stream.reserve(MESSAGES_PER_STREAM);
+  uint64_t t = 1'722'000'000'000'000'000;
+  while (stream.size() < MESSAGES_PER_STREAM) {
+    t += 1 + static_cast<uint64_t>(gap(rng) * burst);
+    const int n = 1 + (burst > 1.0 ? extra(rng) : 0);
+    for (int i = 0; i < n && stream.size() < MESSAGES_PER_STREAM; ++i) {
+      stream.emplace_back(stream.size(), t, 1, 500000, 'A', true);
+    }
+  }
+  return stream;
+}
+} // namespace
+
+// ns per merged message for 2 to 16 synthetic instrument streams
+int main() {
+  std::mt19937_64 rng(42);
+
+  for (double burst : {1.0, 8.0}) {
+    for (size_t k : {2, 4, 8, 16}) {
+      std::vector<std::vector<book_message>> data;
+      std::vector<std::span<const book_message>> streams;
+      for (size_t i = 0; i < k; ++i) {
+        data.push_back(make_stream(rng, burst));
+      }
+      for (const auto &stream : data) {
+        streams.emplace_back(stream);
+      }
+
+      // baseline: touching every message once without merging, so the
+      // difference is what the merge itself costs
+      uint64_t scan_sum = 0;
+      const auto scan_start = std::chrono::steady_clock::now();
+      for (const auto &stream : streams) {
+        for (const auto &m : stream) {
+          scan_sum += m.time_;
+        }
+      }
+      const auto scan_end = std::chrono::steady_clock::now();
+
+      StreamMerger merger(streams);
+      size_t idx;
+      const book_message *first;
+      uint64_t last = 0;
+      uint64_t checksum = 0;
+      size_t count = 0;
+      size_t runs = 0;
+      bool ordered = true;
+
+      const auto start = std::chrono::steady_clock::now();
+      while (const size_t n = merger.next_run(idx, first)) {
+        for (const book_message *m = first; m != first + n; ++m) {
+          ordered &= m->time_ >= last;
+          last = m->time_;
+        }
+        checksum += idx * n;
+        count += n;
+        ++runs;
+      }
+      const auto end = std::chrono::steady_clock::now();
+
+      const double ns =
+          std::chrono::duration<double, std::nano>(end - start).count();
+      const double scan_ns =
+          std::chrono::duration<double, std::nano>(scan_end - scan_start)
+              .count();
+      std::cout << "burst " << burst << ", " << k << " streams: "
+                << ns / count << " ns/msg merged, " << scan_ns / count
+                << " ns/msg scan only, " << static_cast<double>(count) / runs
+                << " msgs/block" << (ordered ? "" : " OUT OF ORDER")
+                << " (checksum " << checksum + (scan_sum & 1) << ")\n";
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,209 @@
+#include "../../include/lock_free_queue.h"
+#include "../../include/spsc_ring.h"
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <pthread.h>
+#include <thread>
+
+namespace {
+constexpr size_t CAPACITY = 1 << 16;
+constexpr uint64_t THROUGHPUT_ITEMS = 50'000'000;
+constexpr uint64_t PING_PONGS = 1'000'000;
+constexpr size_t BATCH = 32;
+
+// producer and consumer on different cores so every handoff crosses a cache
+// line between them. falls back to unpinned when fewer cores are allowed
+void pin(std::thread &thread, unsigned core) {
+  const unsigned cores = std::thread::hardware_concurrency();
+  if (cores < 2) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core % cores, &set);
+  pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+}
+
+// with a single core the other side only runs when this one gives way
+inline void relax() {
+  static const bool shared_core = std::thread::hardware_concurrency() < 2;
+  if (shared_core) {
+    std::this_thread::yield();
+  } else {
+    __builtin_ia32_pause();
+  }
+}
+
+// same surface for both queues so one driver measures either
+struct Mpmc {
+  std::unique_ptr<LockFreeQueue<uint64_t, CAPACITY>> queue_ =
+      std::make_unique<LockFreeQueue<uint64_t, CAPACITY>>();
+  bool push(uint64_t v) { return queue_->enqueue(v); }
+  bool pop(uint64_t &v) {
+    auto item = queue_->dequeue();
+    if (!item) {
+      return false;
+    }
+    v = *item;
+    return true;
+  }
+};
+
+struct Spsc {
+  SpscRing<uint64_t> ring_{CAPACITY};
+  bool push(uint64_t v) { return ring_.try_push(v); }
+  bool pop(uint64_t &v) { return ring_.try_pop(v); }
+};
+
+template <typename Queue>
+double throughput(Queue &queue, uint64_t &checksum) {
+  const auto start = std::chrono::steady_clock::now();
+  std::thread producer([&] {
+    for (uint64_t i = 1; i <= THROUGHPUT_ITEMS; ++i) {
+      while (!queue.push(i)) {
+        relax();
+      }
+    }
+  });
+  std::thread consumer([&] {
+    uint64_t v;
+    for (uint64_t i = 0; i < THROUGHPUT_ITEMS; ++i) {
+      while (!queue.pop(v)) {
+        relax();
+      }
+      checksum += v;
+    }
+  });
+  pin(producer, 0);
+  pin(consumer, 1);
+  producer.join();
+  consumer.join();
+  const auto end = std::chrono::steady_clock::now();
+  return THROUGHPUT_ITEMS /
+         std::chrono::duration<double>(end - start).count();
+}
+
+double batched_throughput(SpscRing<uint64_t> &ring, uint64_t &checksum) {
+  const auto start = std::chrono::steady_clock::now();
+  std::thread producer([&] {
+    uint64_t batch[BATCH];
+    uint64_t next = 1;
+    while (next <= THROUGHPUT_ITEMS) {
+      const size_t n = std::min<uint64_t>(BATCH, THROUGHPUT_ITEMS - next + 1);
+      for (size_t i = 0; i < n; ++i) {
+        batch[i] = next + i;
+      }
+      size_t pushed = 0;
+      while ((pushed += ring.try_push_n(batch + pushed, n - pushed)) < n) {
+        relax();
+      }
+      next += n;
+    }
+  });
+  std::thread consumer([&] {
+    uint64_t batch[BATCH];
+    uint64_t received = 0;
+    while (received < THROUGHPUT_ITEMS) {
+      const size_t n = ring.try_pop_n(batch, BATCH);
+      if (n == 0) {
+        relax();
+      }
+      for (size_t i = 0; i < n; ++i) {
+        checksum += batch[i];
+      }
+      received += n;
+    }
+  });
+  pin(producer, 0);
+  pin(consumer, 1);
+  producer.join();
+  consumer.join();
+  const auto end = std::chrono::steady_clock::now();
+  return THROUGHPUT_ITEMS /
+         std::chrono::duration<double>(end - start).count();
+}
+
+// one item bounces between two threads over a pair of queues; half the
+// round trip is the one way handoff latency between the two cores
+template <typename Queue>
+double one_way_latency_ns(Queue &ping, Queue &pong) {
+  std::thread echo([&] {
+    uint64_t v;
+    for (uint64_t i = 0; i < PING_PONGS; ++i) {
+      while (!ping.pop(v)) {
+        relax();
+      }
+      while (!pong.push(v)) {
+        relax();
+      }
+    }
+  });
+  pin(echo, 1);
+
+  cpu_set_t previous;
+  pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous);
+  if (std::thread::hardware_concurrency() >= 2) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(0, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  }
+
+  uint64_t v;
+  const auto start = std::chrono::steady_clock::now();
+  for (uint64_t i = 0; i < PING_PONGS; ++i) {
+    while (!ping.push(i)) {
+      relax();
+    }
+    while (!pong.pop(v)) {
+      relax();
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+  echo.join();
+  pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+
+  return std::chrono::duration<double, std::nano>(end - start).count() /
+         PING_PONGS / 2;
+}
+
+void report(const char *name, double ops, uint64_t checksum) {
+  constexpr uint64_t expected = THROUGHPUT_ITEMS * (THROUGHPUT_ITEMS + 1) / 2;
+  std::cout << name << ": " << ops / 1e6 << " M ops/s"
+            << (checksum == expected ? "" : " (checksum mismatch)") << "\n";
+}
+} // namespace
+
+// one producer, one consumer: the mpmc lock free queue against the spsc ring
+int main() {
+  {
+    Mpmc queue;
+    uint64_t checksum = 0;
+    const double ops = throughput(queue, checksum);
+    report("mpmc queue", ops, checksum);
+  }
+  {
+    Spsc queue;
+    uint64_t checksum = 0;
+    const double ops = throughput(queue, checksum);
+    report("spsc ring", ops, checksum);
+  }
+  {
+    SpscRing<uint64_t> ring(CAPACITY);
+    uint64_t checksum = 0;
+    const double ops = batched_throughput(ring, checksum);
+    report("spsc ring, batch 32", ops, checksum);
+  }
+  {
+    Mpmc ping, pong;
+    std::cout << "mpmc queue one way latency: "
+              << one_way_latency_ns(ping, pong) << " ns\n";
+  }
+  {
+    Spsc ping, pong;
+    std::cout << "spsc ring one way latency: "
+              << one_way_latency_ns(ping, pong) << " ns\n";
+  }
+  return 0;
+}
@@ -2,15 +2,10 @@
 #include <future>
 #include <iostream>
 
-std::shared_ptr<ConnectionPool> ConcurrentBacktester::connection_pool_ =
-    nullptr;
-std::once_flag ConcurrentBacktester::pool_init_flag_;
-
-ConcurrentBacktester::ConcurrentBacktester() {
-  std::call_once(pool_init_flag_, []() {
-    connection_pool_ = std::make_shared<ConnectionPool>("127.0.0.1", 9009);
-  });
-}
+ConcurrentBacktester::ConcurrentBacktester(LogConfig logging)
+    : logging_(std::move(logging)),
+      feature_store_(std::make_shared<FeatureStore>()),
+      result_cache_(std::make_shared<ResultCache>()) {}
 
 ConcurrentBacktester::~ConcurrentBacktester() { stop_backtest(); }
 
@@ -18,17 +13,28 @@ void ConcurrentBacktester::add_instrument(
     const std::string &instrument_id, std::vector<book_message> &&messages,
     std::vector<book_message> &&train_messages,
     const std::string &backtest_file, const std::string &train_file) {
+  add_instrument(instrument_id, MessageStore::adopt(std::move(messages)),
+                 train_messages.empty()
+                     ? nullptr
+                     : MessageStore::adopt(std::move(train_messages)),
+                 backtest_file, train_file);
+}
+
+void ConcurrentBacktester::add_instrument(
+    const std::string &instrument_id,
+    std::shared_ptr<const MessageStore> messages,
+    std::shared_ptr<const MessageStore> train_messages,
+    const std::string &backtest_file, const std::string &train_file) {
   auto &config = instruments_[instrument_id];
   config.instrument_id = instrument_id;
   config.backtest_file = backtest_file;
   config.train_file = train_file;
 
-  config.messages = std::move(messages);
-  config.train_messages = std::move(train_messages);
-
   config.backtester = std::make_unique<Backtester>(
-      connection_pool_, instrument_id, std::move(config.messages),
-      std::move(config.train_messages));
+      logging_, instrument_id, std::move(messages),
+      std::move(train_messages));
+  config.backtester->set_feature_store(feature_store_);
+  config.backtester->set_result_cache(result_cache_);
 }
 
 void ConcurrentBacktester::stop_backtest() {
@@ -51,6 +57,13 @@ void ConcurrentBacktester::start_backtest(size_t strategy_index) {
         << " instruments\n\n";
   }
 
+  // instrument threads only ever append to their own producer
+  PortfolioAggregator aggregator;
+  for (auto &[id, config] : instruments_) {
+    config.backtester->set_portfolio(&aggregator.add_instrument(id));
+  }
+  aggregator.start();
+
   std::vector<std::future<void>> futures;
 
   for (auto &[id, config] : instruments_) {
@@ -69,7 +82,7 @@ void ConcurrentBacktester::start_backtest(size_t strategy_index) {
             config.backtester->set_trading_times(config.backtest_file,
                                                  config.train_file);
 
-            if (strategy_index == 1) {
+            if (!config.train_file.empty()) {
               {
                 std::lock_guard<std::mutex> lock(cout_mutex_);
                 std::cout << "[" << std::this_thread::get_id() << "] "
@@ -99,6 +112,7 @@ void ConcurrentBacktester::start_backtest(size_t strategy_index) {
                 << config.instrument_id << " backtest: " << e.what()
                 << std::endl;
           }
+          config.backtester->finish_portfolio();
         }));
   }
 
@@ -106,5 +120,32 @@ void ConcurrentBacktester::start_backtest(size_t strategy_index) {
     future.wait();
   }
 
+  portfolio_ = aggregator.finish();
+  for (auto &[id, config] : instruments_) {
+    config.pnl = config.backtester->day_result().pnl_;
+    config.backtester->set_portfolio(nullptr);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cout_mutex_);
+    std::cout << "\nportfolio pnl "
+        << (portfolio_.curve_.empty() ? 0 : portfolio_.curve_.back().pnl_)
+        << " max drawdown " << portfolio_.metrics_.max_drawdown()
+        << " peak gross exposure " << portfolio_.max_gross_exposure_ << "\n";
+  }
+
   running_ = false;
-}
\ No newline at end of file
+}
+DayParallelResult
+ConcurrentBacktester::run_day_parallel(DayParallelConfig config,
+                                       DayParallelBacktester::Loader loader) {
+  {
+    std::lock_guard<std::mutex> lock(cout_mutex_);
+    std::cout << "\nreplaying " << config.files_.size() << " "
+        << config.instrument_id_ << " days in parallel\n";
+  }
+  DayParallelBacktester backtester(logging_, std::move(config),
+                                   std::move(loader), feature_store_,
+                                   result_cache_);
+  return backtester.run();
+}
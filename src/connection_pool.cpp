@@ -4,7 +4,10 @@
 ConnectionPool::ConnectionPool(const std::string &host, int port,
                                size_t initial_size, size_t max_size) :
   host_(host), port_(port), max_size_(max_size),
-  initial_size_(initial_size) {
+  initial_size_(initial_size), reactor_(std::make_shared<IoReactor>()) {
+  // connections_ never reallocates, so next_connection() can index it
+  // without the lock
+  connections_.reserve(max_size_);
   for (size_t i = 0; i < initial_size_; ++i) {
     if (!add_connection()) {
       throw std::runtime_error("failed to create pool");
@@ -19,7 +22,7 @@ bool ConnectionPool::add_connection() {
 
   try {
     auto conn = std::make_unique<Connection>(
-        host_, port_, "conn_" + std::to_string(current_size_));
+        host_, port_, "conn_" + std::to_string(current_size_), reactor_);
 
     std::lock_guard<std::mutex> lock(pool_mutex_);
     connections_.push_back(std::move(conn));
@@ -75,11 +78,17 @@ ConnectionPool::~ConnectionPool() {
   }
 }
 
+Connection *ConnectionPool::next_connection() {
+  const size_t size = current_size_.load();
+  return size ? connections_[next_.fetch_add(1, std::memory_order_relaxed) %
+                             size]
+                    .get()
+              : nullptr;
+}
+
 void ConnectionPool::send_trade_log_pool(const std::string &line_protocol) {
-  auto *conn = acquire_connection();
-  if (conn) {
+  if (auto *conn = next_connection()) {
     conn->send_trade_log(line_protocol);
-    release_connection(conn);
   }
 }
 
@@ -106,17 +115,20 @@ void ConnectionPool::batch_trade_logs(const std::vector<std::string> &logs) {
   log_buffer_.insert(log_buffer_.end(), logs.begin(), logs.end());
 
   if (log_buffer_.size() >= BATCH_SIZE) {
-    auto *conn = acquire_connection();
-    if (conn) {
-      std::string batch;
-      batch.reserve(log_buffer_.size() * 100);
-
+    if (auto *conn = next_connection()) {
+      size_t bytes = 0;
+      for (const auto &log : log_buffer_) {
+        bytes += log.size() + 1;
+      }
+      std::string batch = conn->spare_buffer();
+      batch.clear();
+      batch.reserve(bytes);
       for (const auto &log : log_buffer_) {
-        batch += log + "\n";
+        batch.append(log);
+        batch.push_back('\n');
       }
 
-      conn->send_trade_log(batch);
-      release_connection(conn);
+      conn->send_batch(std::move(batch));
       log_buffer_.clear();
     }
   }
@@ -0,0 +1,202 @@
+#include "../include/day_parallel.h"
+#include <algorithm>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+DayParallelBacktester::DayParallelBacktester(
+    LogConfig logging, DayParallelConfig config, Loader loader,
+    std::shared_ptr<const FeatureStore> store,
+    std::shared_ptr<const ResultCache> results)
+    : logging_(std::move(logging)), config_(std::move(config)),
+      loader_(std::move(loader)), store_(std::move(store)),
+      results_(std::move(results)) {
+  if (!loader_) {
+    throw std::runtime_error("day parallel backtest needs a day loader");
+  }
+}
+
+void DayParallelBacktester::stop() { running_ = false; }
+
+std::shared_ptr<const MessageStore> DayParallelBacktester::load(size_t day) {
+  CachedDay &cached = cache_[day];
+  std::lock_guard<std::mutex> lock(cached.mutex_);
+  if (auto store = cached.store_.lock()) {
+    return store;
+  }
+  auto store = loader_(config_.files_[day]);
+  cached.store_ = store;
+  return store;
+}
+
+DayResult DayParallelBacktester::run_day(size_t day) {
+  const std::string &file = config_.files_[day];
+  std::shared_ptr<const MessageStore> train_messages;
+  std::string train_file;
+  if (config_.train_on_previous_day_) {
+    train_file = config_.files_[day - 1];
+    train_messages = load(day - 1);
+  }
+
+  std::shared_ptr<const BookSnapshot> opening;
+  if (!config_.clean_start_ && day > 0) {
+    opening = openings_[day].get_future().get();
+  }
+
+  Backtester backtester(logging_, config_.instrument_id_, load(day),
+                        std::move(train_messages));
+  backtester.set_opening_snapshot(std::move(opening));
+  backtester.set_feature_store(store_);
+  backtester.set_result_cache(results_);
+  backtester.set_flatten_at_close(config_.carry_ == CarryPolicy::FLATTEN);
+  backtester.create_strategy(config_.strategy_index_);
+  backtester.set_trading_times(file, train_file);
+  if (!train_file.empty()) {
+    backtester.train_model();
+  }
+  backtester.start_backtest();
+  return backtester.day_result();
+}
+
+DayParallelResult DayParallelBacktester::run() {
+  const size_t first = config_.train_on_previous_day_ ? 1 : 0;
+  const size_t days = config_.files_.size();
+  if (days <= first) {
+    return {};
+  }
+
+  cache_ = std::make_unique<CachedDay[]>(days);
+  std::vector<DayResult> results(days - first);
+  std::atomic<size_t> next{first};
+  running_ = true;
+
+  std::future<void> snapshots;
+  if (!config_.clean_start_) {
+    openings_ = std::make_unique<
+        std::promise<std::shared_ptr<const BookSnapshot>>[]>(days);
+    snapshots = std::async(std::launch::async,
+                           [this, days] { build_snapshots(days); });
+  }
+
+  // each worker holds one day's books and messages at a time
+  auto worker = [&]() {
+    for (size_t day = next++; day < days && running_; day = next++) {
+      results[day - first] = run_day(day);
+    }
+  };
+
+  unsigned threads = config_.threads_
+                         ? config_.threads_
+                         : std::max(1u, std::thread::hardware_concurrency());
+  const size_t workers = std::min<size_t>(threads, days - first);
+  std::vector<std::future<void>> futures;
+  for (size_t i = 0; i < workers; ++i) {
+    futures.emplace_back(std::async(std::launch::async, worker));
+  }
+  for (auto &f : futures) {
+    f.get();
+  }
+  running_ = false;
+  if (snapshots.valid()) {
+    snapshots.get();
+  }
+
+  return merge(std::move(results), config_.carry_);
+}
+
+void DayParallelBacktester::build_snapshots(size_t days) {
+  std::vector<std::shared_ptr<const BookSnapshot>> openings(days);
+  std::vector<uint64_t> keys(days, 0);
+  std::vector<bool> published(days, false);
+  try {
+    for (size_t day = 1; day < days && running_; ++day) {
+      keys[day] = FeatureStore::snapshot_key(load(day - 1)->hash(),
+                                             keys[day - 1]);
+      if (store_ && (openings[day] = store_->open_snapshot(keys[day]))) {
+        openings_[day].set_value(openings[day]);
+        published[day] = true;
+      }
+    }
+
+    // the book holds the opening of book_day
+    Orderbook book(100, 7000000);
+    size_t book_day = 0;
+    for (size_t day = 1; day < days && running_; ++day) {
+      if (openings[day]) {
+        continue;
+      }
+      if (book_day != day - 1) {
+        book.clear();
+        for (const auto &order : openings[day - 1]->orders_) {
+          book.process_msg(order);
+        }
+      }
+      for (const auto &m : load(day - 1)->messages()) {
+        book.process_msg(m);
+      }
+      book_day = day;
+
+      auto snapshot = std::make_shared<BookSnapshot>();
+      book.snapshot(snapshot->orders_);
+      snapshot->hash_ = keys[day];
+      if (store_) {
+        try {
+          store_->save_snapshot(*snapshot);
+        } catch (const std::exception &e) {
+          std::cerr << "book snapshot write failed: " << e.what()
+                    << std::endl;
+        }
+      }
+      openings[day] = snapshot;
+      openings_[day].set_value(std::move(snapshot));
+      published[day] = true;
+    }
+  } catch (...) {
+    for (size_t day = 1; day < days; ++day) {
+      if (!published[day]) {
+        openings_[day].set_exception(std::current_exception());
+      }
+    }
+    return;
+  }
+  // stopped early; workers still waiting find running_ cleared anyway
+  for (size_t day = 1; day < days; ++day) {
+    if (!published[day]) {
+      openings_[day].set_value(nullptr);
+    }
+  }
+}
+
+DayParallelResult DayParallelBacktester::merge(std::vector<DayResult> days,
+                                               CarryPolicy policy) {
+  DayParallelResult merged;
+  merged.day_pnl_.reserve(days.size());
+
+  for (size_t i = 0; i < days.size(); ++i) {
+    const DayResult &day = days[i];
+    int64_t pnl = day.pnl_;
+
+    if (policy == CarryPolicy::CARRY_TO_OPEN && day.position_ != 0) {
+      // pnl was marked at the close, the long at the bid and the short at
+      // the ask. move that exit to the next open and pay the closing fee
+      const int pos = day.position_;
+      const int32_t close_px = pos > 0 ? day.close_bid_ : day.close_ask_;
+      int32_t exit_px = close_px;
+      if (i + 1 < days.size()) {
+        const DayResult &next = days[i + 1];
+        exit_px = pos > 0 ? next.open_bid_ : next.open_ask_;
+      }
+      pnl += static_cast<int64_t>(pos) * day.point_value_ *
+                 (exit_px - close_px) -
+             static_cast<int64_t>(std::abs(pos)) * Strategy::fees_per_side();
+    }
+
+    merged.day_pnl_.push_back(pnl);
+    merged.total_pnl_ += pnl;
+  }
+
+  merged.days_ = std::move(days);
+  return merged;
+}
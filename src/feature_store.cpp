@@ -0,0 +1,375 @@
+#include "../include/feature_store.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <xxhash.h>
+
+namespace {
+constexpr char COLUMN_MAGIC[4] = {'F', 'C', 'O', 'L'};
+constexpr uint32_t COLUMN_VERSION = 1;
+constexpr size_t HEADER_BYTES = 64;
+
+struct ColumnHeader {
+  char magic_[4];
+  uint32_t version_;
+  uint32_t elem_size_;
+  uint32_t reserved_;
+  uint64_t rows_;
+};
+static_assert(sizeof(ColumnHeader) <= HEADER_BYTES);
+
+constexpr std::array<const char *, static_cast<size_t>(Feature::COUNT)>
+    COLUMN_NAMES = {"time", "voi",        "mid",       "bid",
+                    "ask",  "microprice", "imbalance", "spread"};
+
+constexpr std::array<uint32_t, static_cast<size_t>(Feature::COUNT)>
+    COLUMN_SIZES = {sizeof(uint64_t), sizeof(int32_t), sizeof(int32_t),
+                    sizeof(int32_t),  sizeof(int32_t), sizeof(double),
+                    sizeof(double),   sizeof(int32_t)};
+
+// written aside under a name of the writing thread and renamed, so
+// concurrent extractions of the same frame never write into one file
+std::string tmp_path(const std::filesystem::path &path) {
+  return path.string() + ".tmp" +
+         std::to_string(
+             std::hash<std::thread::id>{}(std::this_thread::get_id()));
+}
+
+void write_column(const std::filesystem::path &path, const void *data,
+                  uint32_t elem_size, uint64_t rows) {
+  const auto tmp = tmp_path(path);
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    throw std::runtime_error("failed to create column file: " +
+                             std::string(strerror(errno)));
+  }
+
+  std::byte header[HEADER_BYTES]{};
+  ColumnHeader h{};
+  std::memcpy(h.magic_, COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+  h.version_ = COLUMN_VERSION;
+  h.elem_size_ = elem_size;
+  h.rows_ = rows;
+  std::memcpy(header, &h, sizeof(h));
+
+  auto write_all = [fd](const void *buf, size_t len) {
+    auto *p = static_cast<const char *>(buf);
+    while (len > 0) {
+      ssize_t n = ::write(fd, p, len);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      p += n;
+      len -= static_cast<size_t>(n);
+    }
+    return true;
+  };
+
+  const bool ok =
+      write_all(header, HEADER_BYTES) && write_all(data, elem_size * rows);
+  close(fd);
+  if (!ok) {
+    std::filesystem::remove(tmp);
+    throw std::runtime_error("failed to write column file: " +
+                             std::string(strerror(errno)));
+  }
+  std::filesystem::rename(tmp, path);
+}
+
+FeatureFrame::Column map_column(const std::filesystem::path &path,
+                                uint32_t elem_size) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return {};
+  }
+
+  struct stat sb;
+  if (fstat(fd, &sb) == -1 ||
+      static_cast<size_t>(sb.st_size) < HEADER_BYTES) {
+    close(fd);
+    return {};
+  }
+
+  const size_t len = static_cast<size_t>(sb.st_size);
+  void *mem = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    return {};
+  }
+
+  ColumnHeader h{};
+  std::memcpy(&h, mem, sizeof(h));
+  if (std::memcmp(h.magic_, COLUMN_MAGIC, sizeof(COLUMN_MAGIC)) != 0 ||
+      h.version_ != COLUMN_VERSION || h.elem_size_ != elem_size ||
+      HEADER_BYTES + h.rows_ * elem_size > len) {
+    munmap(mem, len);
+    return {};
+  }
+
+  FeatureFrame::Column c;
+  c.data_ = static_cast<const std::byte *>(mem) + HEADER_BYTES;
+  c.rows_ = h.rows_;
+  c.owner_ = std::shared_ptr<const void>(
+      mem, [len](const void *p) { munmap(const_cast<void *>(p), len); });
+  return c;
+}
+
+template <typename T>
+FeatureFrame::Column own_column(std::vector<T> &&values) {
+  auto owned = std::make_shared<std::vector<T>>(std::move(values));
+  FeatureFrame::Column c;
+  c.data_ = reinterpret_cast<const std::byte *>(owned->data());
+  c.rows_ = owned->size();
+  c.owner_ = owned;
+  return c;
+}
+} // namespace
+
+FeatureSpec FeatureSpec::time_bars(uint64_t interval_ns, uint32_t columns) {
+  FeatureSpec spec;
+  spec.sampler_tag_ = "time" + std::to_string(interval_ns);
+  spec.make_sampler_ = [interval_ns]() {
+    return std::make_unique<TimeSampler>(interval_ns);
+  };
+  spec.columns_ = columns;
+  return spec;
+}
+
+FeatureStore::FeatureStore(std::filesystem::path root)
+    : root_(std::move(root)) {}
+
+uint64_t FeatureStore::hash_messages(std::span<const book_message> messages) {
+  // pack fields so padding bytes never reach the hash
+  constexpr size_t RECORD = 8 + 8 + 4 + 4 + 1 + 1;
+  constexpr size_t BATCH = 2048;
+  std::vector<char> buf(RECORD * BATCH);
+
+  XXH3_state_t *state = XXH3_createState();
+  XXH3_64bits_reset(state);
+  for (size_t i = 0; i < messages.size(); i += BATCH) {
+    const size_t n = std::min(BATCH, messages.size() - i);
+    char *p = buf.data();
+    for (size_t j = 0; j < n; ++j) {
+      const book_message &m = messages[i + j];
+      std::memcpy(p, &m.id_, 8);
+      std::memcpy(p + 8, &m.time_, 8);
+      std::memcpy(p + 16, &m.size_, 4);
+      std::memcpy(p + 20, &m.price_, 4);
+      p[24] = m.action_;
+      p[25] = static_cast<char>(m.side_);
+      p += RECORD;
+    }
+    XXH3_64bits_update(state, buf.data(), n * RECORD);
+  }
+  const uint64_t hash = XXH3_64bits_digest(state);
+  XXH3_freeState(state);
+  return hash;
+}
+
+uint64_t FeatureStore::snapshot_key(uint64_t prev_data_hash,
+                                    uint64_t prev_key) {
+  const uint64_t parts[2] = {prev_data_hash, prev_key};
+  return XXH3_64bits(parts, sizeof(parts));
+}
+
+std::filesystem::path FeatureStore::snapshot_path(uint64_t key) const {
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+  return root_ / "snapshots" /
+         (std::string(hex) + "_v" + std::to_string(SNAPSHOT_VERSION) +
+          ".book");
+}
+
+std::shared_ptr<const BookSnapshot>
+FeatureStore::open_snapshot(uint64_t key) const {
+  const auto column = map_column(snapshot_path(key), sizeof(book_message));
+  if (!column.data_) {
+    return nullptr;
+  }
+  auto snapshot = std::make_shared<BookSnapshot>();
+  const auto *orders = reinterpret_cast<const book_message *>(column.data_);
+  snapshot->orders_.assign(orders, orders + column.rows_);
+  snapshot->hash_ = key;
+  return snapshot;
+}
+
+void FeatureStore::save_snapshot(const BookSnapshot &snapshot) const {
+  const auto path = snapshot_path(snapshot.hash_);
+  std::filesystem::create_directories(path.parent_path());
+  write_column(path, snapshot.orders_.data(), sizeof(book_message),
+               snapshot.orders_.size());
+}
+
+std::filesystem::path FeatureStore::frame_dir(uint64_t data_hash,
+                                              uint64_t start_ns,
+                                              uint64_t end_ns,
+                                              const FeatureSpec &spec) const {
+  char hex[17];
+  snprintf(hex, sizeof(hex), "%016llx",
+           static_cast<unsigned long long>(data_hash));
+  return root_ / hex /
+         (spec.sampler_tag_ + "_d" + std::to_string(spec.depth_) + "_v" +
+          std::to_string(EXTRACTOR_VERSION) + "_" + std::to_string(start_ns) +
+          "_" + std::to_string(end_ns));
+}
+
+std::optional<FeatureFrame> FeatureStore::open(uint64_t data_hash,
+                                               uint64_t start_ns,
+                                               uint64_t end_ns,
+                                               const FeatureSpec &spec) const {
+  const auto dir = frame_dir(data_hash, start_ns, end_ns, spec);
+  std::ifstream manifest(dir / "manifest");
+  uint32_t stored = 0;
+  size_t rows = 0;
+  if (!(manifest >> stored >> rows) || (spec.columns_ & ~stored) != 0) {
+    return std::nullopt;
+  }
+
+  FeatureFrame frame;
+  frame.rows_ = rows;
+  for (size_t i = 0; i < COLUMN_NAMES.size(); ++i) {
+    if (!(spec.columns_ & (1u << i))) {
+      continue;
+    }
+    auto column = map_column(dir / (std::string(COLUMN_NAMES[i]) + ".col"),
+                             COLUMN_SIZES[i]);
+    if (!column.data_ || column.rows_ != rows) {
+      return std::nullopt;
+    }
+    frame.columns_[i] = std::move(column);
+  }
+  return frame;
+}
+
+FeatureFrame FeatureStore::extract(std::span<const book_message> messages,
+                                   uint64_t start_ns, uint64_t end_ns,
+                                   const FeatureSpec &spec,
+                                   Orderbook &book) const {
+  std::vector<uint64_t> time;
+  std::vector<int32_t> voi, mid, bid, ask, spread;
+  std::vector<double> microprice, imbalance;
+
+  VoiState voi_state;
+  const uint32_t cols = spec.columns_;
+  const size_t depth = spec.depth_;
+
+  auto sampler = spec.make_sampler_();
+  sampler->subscribe([&](const Bar &bar) {
+    const int32_t b = book.get_best_bid_price();
+    const int32_t a = book.get_best_ask_price();
+    const int32_t bv = book.get_best_bid_volume();
+    const int32_t av = book.get_best_ask_volume();
+    const int32_t bar_voi = voi_state.update(b, a, bv, av);
+
+    if (cols & feature_bit(Feature::TIME))
+      time.push_back(bar.close_time_);
+    if (cols & feature_bit(Feature::VOI))
+      voi.push_back(bar_voi);
+    if (cols & feature_bit(Feature::MID))
+      mid.push_back(book.get_mid_price());
+    if (cols & feature_bit(Feature::BID))
+      bid.push_back(b);
+    if (cols & feature_bit(Feature::ASK))
+      ask.push_back(a);
+    if (cols & feature_bit(Feature::MICROPRICE)) {
+      const int64_t vol = static_cast<int64_t>(bv) + av;
+      microprice.push_back(
+          vol > 0 ? (static_cast<double>(b) * av + static_cast<double>(a) * bv) /
+                        static_cast<double>(vol)
+                  : 0.5 * (static_cast<double>(b) + a));
+    }
+    if (cols & feature_bit(Feature::IMBALANCE))
+      imbalance.push_back(book.get_depth_imbalance(depth));
+    if (cols & feature_bit(Feature::SPREAD))
+      spread.push_back(a - b);
+  });
+
+  size_t rows = 0;
+  sampler->subscribe([&rows](const Bar &) { ++rows; });
+
+  for (const auto &m : messages) {
+    book.process_msg(m);
+    if (m.time_ >= start_ns) {
+      sampler->on_message(m, book);
+    }
+    if (m.time_ >= end_ns) {
+      break;
+    }
+  }
+
+  FeatureFrame frame;
+  frame.rows_ = rows;
+  frame.columns_[0] = own_column(std::move(time));
+  frame.columns_[1] = own_column(std::move(voi));
+  frame.columns_[2] = own_column(std::move(mid));
+  frame.columns_[3] = own_column(std::move(bid));
+  frame.columns_[4] = own_column(std::move(ask));
+  frame.columns_[5] = own_column(std::move(microprice));
+  frame.columns_[6] = own_column(std::move(imbalance));
+  frame.columns_[7] = own_column(std::move(spread));
+  for (size_t i = 0; i < COLUMN_NAMES.size(); ++i) {
+    if (!(cols & (1u << i))) {
+      frame.columns_[i] = {};
+    }
+  }
+  return frame;
+}
+
+FeatureFrame FeatureStore::load_or_extract(
+    std::span<const book_message> messages, uint64_t start_ns, uint64_t end_ns,
+    const FeatureSpec &spec, Orderbook &scratch_book) const {
+  return load_or_extract(hash_messages(messages), messages, start_ns, end_ns,
+                         spec, scratch_book);
+}
+
+FeatureFrame FeatureStore::load_or_extract(
+    uint64_t hash, std::span<const book_message> messages, uint64_t start_ns,
+    uint64_t end_ns, const FeatureSpec &spec, Orderbook &scratch_book) const {
+  if (auto cached = open(hash, start_ns, end_ns, spec)) {
+    return std::move(*cached);
+  }
+
+  FeatureFrame frame = extract(messages, start_ns, end_ns, spec, scratch_book);
+
+  try {
+    const auto dir = frame_dir(hash, start_ns, end_ns, spec);
+    std::filesystem::create_directories(dir);
+    for (size_t i = 0; i < COLUMN_NAMES.size(); ++i) {
+      const auto &c = frame.columns_[i];
+      if (c.data_) {
+        write_column(dir / (std::string(COLUMN_NAMES[i]) + ".col"), c.data_,
+                     COLUMN_SIZES[i], c.rows_);
+      }
+    }
+    const auto manifest_tmp = tmp_path(dir / "manifest");
+    {
+      std::ofstream manifest(manifest_tmp, std::ios::trunc);
+      manifest << spec.columns_ << ' ' << frame.rows_ << '\n';
+      if (!manifest) {
+        throw std::runtime_error("failed to write feature manifest");
+      }
+    }
+    std::filesystem::rename(manifest_tmp, dir / "manifest");
+  } catch (const std::exception &e) {
+    std::cerr << "feature cache write failed, keeping columns in memory: "
+              << e.what() << std::endl;
+    return frame;
+  }
+
+  if (auto mapped = open(hash, start_ns, end_ns, spec)) {
+    return std::move(*mapped);
+  }
+  return frame;
+}
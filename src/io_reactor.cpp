@@ -0,0 +1,359 @@
+#include "../include/io_reactor.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+constexpr uint32_t WAKE_TOKEN = UINT32_MAX;
+constexpr size_t MAX_GATHER = 64;
+} // namespace
+
+IoReactor::IoReactor() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ == -1 || wake_fd_ == -1) {
+    throw std::runtime_error("failed to create reactor: " +
+                             std::string(strerror(errno)));
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u32 = WAKE_TOKEN;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+  thread_ = std::thread(&IoReactor::run, this);
+}
+
+IoReactor::~IoReactor() {
+  running_ = false;
+  wake();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  for (uint32_t i = 0; i < endpoint_count_; ++i) {
+    if (endpoints_[i]->fd_ != -1) {
+      close(endpoints_[i]->fd_);
+    }
+  }
+  close(wake_fd_);
+  close(epoll_fd_);
+}
+
+std::shared_ptr<IoReactor> IoReactor::shared() {
+  static std::mutex mutex;
+  static std::weak_ptr<IoReactor> current;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto reactor = current.lock();
+  if (!reactor) {
+    reactor = std::make_shared<IoReactor>();
+    current = reactor;
+  }
+  return reactor;
+}
+
+uint32_t IoReactor::add_endpoint(const std::string &host, int port,
+                                 const std::string &id) {
+  auto endpoint = std::make_unique<Endpoint>();
+  endpoint->id_ = id;
+  endpoint->addr_.sin_family = AF_INET;
+  endpoint->addr_.sin_port = htons(port);
+  if (inet_pton(AF_INET, host.c_str(), &endpoint->addr_.sin_addr) <= 0) {
+    throw std::runtime_error("invalid address: " + host);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint32_t index = endpoint_count_.load(std::memory_order_relaxed);
+  if (index == MAX_ENDPOINTS) {
+    throw std::runtime_error("too many reactor endpoints");
+  }
+  endpoint->index_ = index;
+  endpoints_[index] = std::move(endpoint);
+  endpoint_count_.store(index + 1, std::memory_order_release);
+  return index;
+}
+
+std::string IoReactor::spare_buffer(uint32_t endpoint) {
+  std::optional<std::string> buffer = endpoints_[endpoint]->spares_.dequeue();
+  return buffer ? std::move(*buffer) : std::string();
+}
+
+bool IoReactor::connected(uint32_t endpoint) const {
+  return endpoints_[endpoint]->connected_.load(std::memory_order_relaxed);
+}
+
+uint64_t IoReactor::bytes_sent(uint32_t endpoint) const {
+  return endpoints_[endpoint]->bytes_sent_.load(std::memory_order_relaxed);
+}
+
+uint64_t IoReactor::writes(uint32_t endpoint) const {
+  return endpoints_[endpoint]->writes_.load(std::memory_order_relaxed);
+}
+
+void IoReactor::wake() {
+  const uint64_t one = 1;
+  [[maybe_unused]] ssize_t n = ::write(wake_fd_, &one, sizeof(one));
+}
+
+void IoReactor::run() {
+  epoll_event events[64];
+  std::chrono::steady_clock::time_point shutdown_deadline{};
+
+  while (true) {
+    const bool submitted = drain_lanes();
+
+    const auto now = std::chrono::steady_clock::now();
+    const uint32_t count = endpoint_count_.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i) {
+      Endpoint &endpoint = *endpoints_[i];
+      if (endpoint.out_.empty()) {
+        continue;
+      }
+      if (endpoint.state_ == State::IDLE ||
+          (endpoint.state_ == State::BACKOFF && now >= endpoint.retry_at_)) {
+        start_connect(endpoint);
+      } else if (endpoint.state_ == State::CONNECTED && !endpoint.want_write_) {
+        flush(endpoint);
+      }
+    }
+
+    int timeout = submitted ? 0 : next_timeout_ms();
+    if (!running_) {
+      if (shutdown_deadline == std::chrono::steady_clock::time_point{}) {
+        shutdown_deadline = now + SHUTDOWN_GRACE;
+      }
+      if ((idle() && !lanes_.pending()) || now >= shutdown_deadline) {
+        break;
+      }
+      timeout = timeout < 0 ? 10 : std::min(timeout, 10);
+    }
+
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (lanes_.pending()) {
+      timeout = 0;
+    }
+    const int n = epoll_wait(epoll_fd_, events, std::size(events), timeout);
+    sleeping_.store(false, std::memory_order_relaxed);
+
+    for (int e = 0; e < n; ++e) {
+      const uint32_t token = events[e].data.u32;
+      const uint32_t ready = events[e].events;
+      if (token == WAKE_TOKEN) {
+        uint64_t value;
+        [[maybe_unused]] ssize_t r = ::read(wake_fd_, &value, sizeof(value));
+        continue;
+      }
+
+      Endpoint &endpoint = *endpoints_[token];
+      if (endpoint.state_ == State::CONNECTING) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(endpoint.fd_, SOL_SOCKET, SO_ERROR, &error, &len);
+        if (error) {
+          fail(endpoint, "connection failed", error);
+        } else if (ready & EPOLLOUT) {
+          on_connected(endpoint);
+        }
+        continue;
+      }
+      if (endpoint.state_ != State::CONNECTED) {
+        continue;
+      }
+      if (ready & EPOLLIN) {
+        // the database does not answer on this protocol; a read of 0 is the
+        // peer closing
+        char discard[512];
+        const ssize_t r = ::read(endpoint.fd_, discard, sizeof(discard));
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) {
+          fail(endpoint, "connection closed", r == 0 ? ECONNRESET : errno);
+          continue;
+        }
+      }
+      if (ready & (EPOLLERR | EPOLLHUP)) {
+        fail(endpoint, "connection error", ECONNRESET);
+        continue;
+      }
+      if (ready & EPOLLOUT) {
+        flush(endpoint);
+      }
+    }
+  }
+}
+
+bool IoReactor::drain_lanes() {
+  bool any = false;
+  Submission batch[32];
+  const size_t lanes = lanes_.size();
+  for (size_t l = 0; l < lanes; ++l) {
+    // one batch per lane per pass, so a busy lane cannot hold up writes
+    const size_t n = lanes_.lane(l).try_pop_n(batch, std::size(batch));
+    any |= n > 0;
+    {
+      for (size_t i = 0; i < n; ++i) {
+        Endpoint &endpoint = *endpoints_[batch[i].endpoint_];
+        std::string &bytes = batch[i].bytes_;
+        if (bytes.empty()) {
+          continue;
+        }
+        if (endpoint.out_bytes_ + bytes.size() > MAX_PENDING_BYTES) {
+          dropped_.fetch_add(1, std::memory_order_relaxed);
+          continue;
+        }
+        endpoint.out_bytes_ += bytes.size();
+        endpoint.out_.push_back(std::move(bytes));
+      }
+    }
+  }
+  return any;
+}
+
+void IoReactor::start_connect(Endpoint &endpoint) {
+  endpoint.fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (endpoint.fd_ == -1) {
+    fail(endpoint, "socket creation error", errno);
+    return;
+  }
+  const int rc = ::connect(endpoint.fd_,
+                           reinterpret_cast<const sockaddr *>(&endpoint.addr_),
+                           sizeof(endpoint.addr_));
+  if (rc == -1 && errno != EINPROGRESS) {
+    fail(endpoint, "connection failed", errno);
+    return;
+  }
+
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+  event.data.u32 = endpoint.index_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, endpoint.fd_, &event);
+  endpoint.want_write_ = true;
+  endpoint.state_ = State::CONNECTING;
+  if (rc == 0) {
+    on_connected(endpoint);
+  }
+}
+
+void IoReactor::on_connected(Endpoint &endpoint) {
+  endpoint.state_ = State::CONNECTED;
+  endpoint.backoff_ = INITIAL_BACKOFF;
+  endpoint.connected_.store(true, std::memory_order_relaxed);
+  flush(endpoint);
+}
+
+void IoReactor::fail(Endpoint &endpoint, const char *what, int error) {
+  std::cerr << endpoint.id_ << " " << what << ": " << strerror(error)
+            << std::endl;
+  if (endpoint.fd_ != -1) {
+    close(endpoint.fd_);
+    endpoint.fd_ = -1;
+  }
+  endpoint.want_write_ = false;
+  endpoint.connected_.store(false, std::memory_order_relaxed);
+  endpoint.state_ = State::BACKOFF;
+  endpoint.retry_at_ = std::chrono::steady_clock::now() + endpoint.backoff_;
+  endpoint.backoff_ = std::min(endpoint.backoff_ * 2, MAX_BACKOFF);
+
+  // the cut line was lost with the socket; resend it whole
+  if (endpoint.offset_ > 0) {
+    const std::string &front = endpoint.out_.front();
+    const size_t newline = front.rfind('\n', endpoint.offset_ - 1);
+    endpoint.offset_ = newline == std::string::npos ? 0 : newline + 1;
+  }
+}
+
+void IoReactor::flush(Endpoint &endpoint) {
+  iovec iov[MAX_GATHER];
+  while (!endpoint.out_.empty()) {
+    size_t count = 0;
+    for (auto it = endpoint.out_.begin();
+         it != endpoint.out_.end() && count < MAX_GATHER; ++it, ++count) {
+      const size_t skip = count == 0 ? endpoint.offset_ : 0;
+      iov[count].iov_base = it->data() + skip;
+      iov[count].iov_len = it->size() - skip;
+    }
+    msghdr msg{};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = count;
+    // sendmsg rather than writev so a closed peer is an error, not SIGPIPE
+    const ssize_t sent = ::sendmsg(endpoint.fd_, &msg, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        update_interest(endpoint, true);
+        return;
+      }
+      fail(endpoint, "error sending data", errno);
+      return;
+    }
+    endpoint.bytes_sent_.fetch_add(static_cast<uint64_t>(sent),
+                                   std::memory_order_relaxed);
+    endpoint.writes_.fetch_add(1, std::memory_order_relaxed);
+
+    size_t left = static_cast<size_t>(sent);
+    while (left > 0) {
+      std::string &front = endpoint.out_.front();
+      const size_t remaining = front.size() - endpoint.offset_;
+      if (left < remaining) {
+        endpoint.offset_ += left;
+        break;
+      }
+      left -= remaining;
+      endpoint.out_bytes_ -= front.size();
+      endpoint.offset_ = 0;
+      // only batch sized buffers are worth handing back
+      if (front.capacity() >= 4096) {
+        endpoint.spares_.enqueue(std::move(front));
+      }
+      endpoint.out_.pop_front();
+    }
+  }
+  update_interest(endpoint, false);
+}
+
+void IoReactor::update_interest(Endpoint &endpoint, bool want_write) {
+  if (endpoint.want_write_ == want_write) {
+    return;
+  }
+  epoll_event event{};
+  event.events = EPOLLIN | EPOLLRDHUP;
+  if (want_write) {
+    event.events |= EPOLLOUT;
+  }
+  event.data.u32 = endpoint.index_;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, endpoint.fd_, &event);
+  endpoint.want_write_ = want_write;
+}
+
+bool IoReactor::idle() const {
+  const uint32_t count = endpoint_count_.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < count; ++i) {
+    if (!endpoints_[i]->out_.empty()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int IoReactor::next_timeout_ms() const {
+  const auto now = std::chrono::steady_clock::now();
+  int timeout = -1;
+  const uint32_t count = endpoint_count_.load(std::memory_order_acquire);
+  for (uint32_t i = 0; i < count; ++i) {
+    const Endpoint &endpoint = *endpoints_[i];
+    if (endpoint.state_ != State::BACKOFF || endpoint.out_.empty()) {
+      continue;
+    }
+    const auto wait = std::chrono::ceil<std::chrono::milliseconds>(
+        endpoint.retry_at_ - now);
+    const int ms = static_cast<int>(std::max<int64_t>(wait.count(), 0));
+    timeout = timeout < 0 ? ms : std::min(timeout, ms);
+  }
+  return timeout;
+}
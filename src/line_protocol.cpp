@@ -0,0 +1,40 @@
+#include "../include/line_protocol.h"
+#include "../include/text_format.h"
+
+LineProtocolBatch::LineProtocolBatch(size_t flush_bytes,
+                                     std::chrono::nanoseconds flush_interval)
+    : flush_bytes_(flush_bytes), flush_interval_(flush_interval) {
+  buffer_.resize(flush_bytes_ + MAX_LINE);
+}
+
+size_t LineProtocolBatch::encode(char *out, std::string_view instrument,
+                                 const LogRecord &record) {
+  using namespace text;
+  char *p = out;
+  p = put(p, "trading_log_");
+  p = put(p, instrument.substr(0, MAX_INSTRUMENT));
+  p = put(p, " bid=");
+  p = put_int(p, record.bid_);
+  p = put(p, "i,ask=");
+  p = put_int(p, record.ask_);
+  p = put(p, "i,position=");
+  p = put_int(p, record.position_);
+  p = put(p, "i,trade_count=");
+  p = put_int(p, record.trade_count_);
+  p = put(p, "i,pnl=");
+  p = put_int(p, record.pnl_);
+  *p++ = ' ';
+  p = put_int(p, record.time_ns_);
+  *p++ = '\n';
+  return static_cast<size_t>(p - out);
+}
+
+std::string LineProtocolBatch::take(std::string spare) {
+  buffer_.resize(used_);
+  std::string full = std::move(buffer_);
+  buffer_ = std::move(spare);
+  // a recycled buffer already has the capacity, so this only fills it
+  buffer_.resize(flush_bytes_ + MAX_LINE);
+  used_ = 0;
+  return full;
+}
@@ -0,0 +1,186 @@
+#include "../include/log_service.h"
+#include <algorithm>
+#include <filesystem>
+#include <pthread.h>
+#include <stdexcept>
+
+LogService &LogService::instance() {
+  static LogService service;
+  return service;
+}
+
+LogService::LogService() : streams_(std::make_unique<Stream[]>(MAX_STREAMS)) {
+  // keep the logger off the cores the replays start on
+  const unsigned cores = std::thread::hardware_concurrency();
+  if (cores > 2) {
+    pin_cpu_ = static_cast<int>(cores - 1);
+  }
+}
+
+void LogService::start_consumer() {
+  if (consumer_thread_.joinable()) {
+    return;
+  }
+  consumer_thread_ = std::thread(&LogService::consumer_loop, this);
+  apply_pin();
+}
+
+void LogService::set_wait_mode(WaitMode mode) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (mode == wait_.mode()) {
+    return;
+  }
+  if (consumer_thread_.joinable()) {
+    throw std::runtime_error("log wait mode is fixed once a stream is open");
+  }
+  wait_.set_mode(mode);
+}
+
+LogService::~LogService() {
+  running_ = false;
+  wait_.wake();
+  if (consumer_thread_.joinable()) {
+    consumer_thread_.join();
+  }
+  for (auto &[key, sink] : sinks_) {
+    sink->close();
+  }
+}
+
+template <typename Sink, typename... Args>
+LogSink *LogService::sink(const std::string &key, Args &&...args) {
+  auto &slot = sinks_[key];
+  if (!slot) {
+    slot = std::make_unique<Sink>(std::forward<Args>(args)...);
+  }
+  return slot.get();
+}
+
+uint32_t LogService::open_stream(const std::string &log_file,
+                                 const std::string &instrument_id,
+                                 const LogConfig &config) {
+  std::string key = log_file + '\0' + instrument_id + '\0';
+  key += config.console_ ? 'c' : '-';
+  key += config.csv_ ? 's' : '-';
+  key += config.binary_ ? 'b' : '-';
+  if (config.database_) {
+    key += config.db_host_ + ':' + std::to_string(config.db_port_);
+  }
+  if (config.memory_) {
+    key += '\0' + std::to_string(
+                      reinterpret_cast<uintptr_t>(config.memory_.get()));
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto [it, inserted] = stream_ids_.try_emplace(key, stream_count_);
+  if (!inserted) {
+    return it->second;
+  }
+  if (it->second == MAX_STREAMS) {
+    stream_ids_.erase(it);
+    throw std::runtime_error("too many log streams");
+  }
+
+  std::vector<LogSink *> sinks;
+  if (config.console_) {
+    sinks.push_back(sink<ConsoleSink>("console"));
+  }
+  if (config.csv_) {
+    sinks.push_back(sink<CsvSink>("csv:" + log_file, log_file));
+  }
+  if (config.binary_) {
+    std::filesystem::path path(log_file);
+    path.replace_filename(path.stem().string() + "_" + instrument_id + ".bin");
+    sinks.push_back(sink<BinarySink>("bin:" + path.string(), path.string()));
+  }
+  if (config.database_) {
+    sinks.push_back(sink<LineProtocolSink>(
+        "db:" + config.db_host_ + ":" + std::to_string(config.db_port_),
+        config.db_host_, config.db_port_));
+  }
+  if (config.memory_) {
+    if (std::find(memory_sinks_.begin(), memory_sinks_.end(),
+                  config.memory_) == memory_sinks_.end()) {
+      memory_sinks_.push_back(config.memory_);
+    }
+    sinks.push_back(config.memory_.get());
+  }
+
+  streams_[it->second] = Stream{instrument_id, std::move(sinks)};
+  ++stream_count_;
+  start_consumer();
+  return it->second;
+}
+
+void LogService::pin_consumer(int cpu) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pin_cpu_ = cpu;
+  apply_pin();
+}
+
+void LogService::apply_pin() {
+  if (pin_cpu_ == INT_MIN || !consumer_thread_.joinable()) {
+    return;
+  }
+  const int cpu = pin_cpu_;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (cpu < 0) {
+    for (unsigned i = 0; i < std::thread::hardware_concurrency(); ++i) {
+      CPU_SET(i, &set);
+    }
+  } else {
+    CPU_SET(cpu, &set);
+  }
+  pthread_setaffinity_np(consumer_thread_.native_handle(), sizeof(set), &set);
+}
+
+void LogService::consumer_loop() {
+  const size_t FLUSH_BATCH_SIZE = 1000;
+  size_t entries_since_flush = 0;
+  // sinks written since the last flush
+  std::vector<LogSink *> dirty;
+
+  auto flush = [&] {
+    for (auto *sink : dirty) {
+      sink->flush();
+    }
+    dirty.clear();
+    entries_since_flush = 0;
+  };
+
+  LogRecord batch[64];
+  while (true) {
+    bool drained_any = false;
+    const size_t lanes = lanes_.size();
+    for (size_t l = 0; l < lanes; ++l) {
+      const size_t n = lanes_.lane(l).try_pop_n(batch, std::size(batch));
+      drained_any |= n > 0;
+      for (size_t i = 0; i < n; ++i) {
+        const LogRecord &record = batch[i];
+        const Stream &stream = streams_[record.stream_];
+        for (auto *sink : stream.sinks_) {
+          sink->write(record, stream.instrument_id_);
+          if (std::find(dirty.begin(), dirty.end(), sink) == dirty.end()) {
+            dirty.push_back(sink);
+          }
+        }
+        // records from many instruments interleave, so simulated time is
+        // no flush clock here; idle passes flush whatever is left
+        if (++entries_since_flush >= FLUSH_BATCH_SIZE) {
+          flush();
+        }
+      }
+    }
+    if (drained_any) {
+      continue;
+    }
+    // a final pass that found nothing after shutdown was requested
+    if (!running_) {
+      break;
+    }
+    flush();
+    wait_.wait([this] { return lanes_.pending() || !running_; });
+  }
+  flush();
+}
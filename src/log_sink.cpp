@@ -0,0 +1,88 @@
+#include "../include/log_sink.h"
+#include "../include/text_format.h"
+#include <cstdio>
+
+namespace {
+using text::put;
+using text::put_int;
+using text::put_time;
+} // namespace
+
+void ConsoleSink::write(const LogRecord &record, std::string_view instrument) {
+  char line[256];
+  char *p = line;
+  p = put(p, "\033[1;36m");
+  p = put_time(p, record.time_ns_);
+  p = put(p, "\033[0m | instrument: ");
+  p = put(p, instrument.substr(0, LineProtocolBatch::MAX_INSTRUMENT));
+  p = put(p, " | position: ");
+  p = put_int(p, record.position_);
+  p = put(p, " | bid/ask: ");
+  p = put_int(p, record.bid_);
+  *p++ = '/';
+  p = put_int(p, record.ask_);
+  p = put(p, " | pnl: ");
+  p = put(p, record.pnl_ >= 0 ? "\033[1;32m" : "\033[1;31m");
+  p = put_int(p, record.pnl_);
+  p = put(p, "\033[0m\n");
+  std::fwrite(line, 1, static_cast<size_t>(p - line), stdout);
+}
+
+void ConsoleSink::flush() { std::fflush(stdout); }
+
+CsvSink::CsvSink(const std::string &path)
+    : writer_(path, SegmentedMmapWriter::DEFAULT_SEGMENT_BYTES, 0,
+              "timestamp,bid,ask,position,trade_count,pnl,instrument\n") {}
+
+void CsvSink::write(const LogRecord &record, std::string_view instrument) {
+  char line[160];
+  char *p = line;
+  p = put_time(p, record.time_ns_);
+  *p++ = ',';
+  p = put_int(p, record.bid_);
+  *p++ = ',';
+  p = put_int(p, record.ask_);
+  *p++ = ',';
+  p = put_int(p, record.position_);
+  *p++ = ',';
+  p = put_int(p, record.trade_count_);
+  *p++ = ',';
+  p = put_int(p, record.pnl_);
+  *p++ = ',';
+  p = put(p, instrument.substr(0, LineProtocolBatch::MAX_INSTRUMENT));
+  *p++ = '\n';
+  writer_.write(line, static_cast<size_t>(p - line));
+}
+
+BinarySink::BinarySink(const std::string &path)
+    : writer_(path, SegmentedMmapWriter::DEFAULT_SEGMENT_BYTES, 0,
+              std::string(MAGIC)) {}
+
+LineProtocolSink::LineProtocolSink(const std::string &host, int port)
+    : connection_(host, port, "log_" + host + ":" + std::to_string(port)) {}
+
+void LineProtocolSink::flush() {
+  if (batch_.empty()) {
+    return;
+  }
+  connection_.send_batch(batch_.take(connection_.spare_buffer()));
+}
+
+MemorySink::MemorySink(size_t capacity) : records_(capacity ? capacity : 1) {}
+
+std::vector<LogRecord> MemorySink::snapshot() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const size_t size = records_.size();
+  const size_t count = written_ < size ? written_ : size;
+  std::vector<LogRecord> out;
+  out.reserve(count);
+  for (uint64_t i = written_ - count; i < written_; ++i) {
+    out.push_back(records_[i % size]);
+  }
+  return out;
+}
+
+uint64_t MemorySink::written() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return written_;
+}
@@ -4,11 +4,13 @@
 #include <algorithm>
 #include <iomanip>
 #include "../include/concurrent_backtest.h"
+#include "../include/message_store.h"
+#include "../include/walk_forward.h"
 #include "parser.cpp"
 #include "../include/message.h"
 
 inline std::vector<std::string> get_available_strategies() {
-    return {"imbalance_strat", "linear_model_strat"};
+    return {"imbalance_strat", "linear_model_strat", "linear_model_online_strat"};
 }
 
 inline std::vector<std::string> get_available_data_files() {
@@ -39,10 +41,77 @@ inline std::vector<std::string> filter_files_by_prefix(const std::vector<std::st
     return filtered;
 }
 
-int main() {
+// parsing a csv day takes seconds, so the parsed records are kept next to the
+// build as raw binary and mapped straight back on the next run, as long as
+// the csv still has the size and mtime it was parsed at
+inline std::shared_ptr<const MessageStore> load_day(const std::filesystem::path &base_path,
+                                                    const std::string &file) {
+    const std::filesystem::path source = base_path / file;
+    const std::filesystem::path cached = std::filesystem::path("message_cache") /
+                                         (std::filesystem::path(file).stem().string() + ".msgs");
+    if (std::filesystem::exists(cached)) {
+        try {
+            return MessageStore::map_file(cached, source);
+        } catch (const std::exception &) {
+            // stale or truncated, parse again and overwrite it
+        }
+    }
+
+    Parser parser(source.string());
+    parser.parse();
     try {
-        auto multi_backtest = std::make_unique<ConcurrentBacktester>();
+        MessageStore::save(cached, parser.message_stream_, source);
+        return MessageStore::map_file(cached, source);
+    } catch (const std::exception &) {
+        return MessageStore::adopt(std::move(parser.message_stream_));
+    }
+}
+
+// train on the previous train_days files, test on the next, for every day of
+// the instrument; thresholds mirror linear_model_strat's
+inline void run_walk_forward(const std::string &prefix,
+                             const std::vector<std::string> &files,
+                             const std::filesystem::path &base_path) {
+    size_t train_days;
+    std::cout << "training days per window: ";
+    std::cin >> train_days;
+
+    WalkForwardConfig config;
+    config.instrument_id_ = prefix;
+    config.files_ = files;
+    config.train_days_ = train_days;
+    if (prefix == "es") {
+        config.point_value_ = 5;
+        config.thresholds_ = {1.0, 2.0, 3.0, 4.0};
+    } else {
+        config.point_value_ = 2;
+        config.thresholds_ = {10.0, 20.0, 30.0, 40.0};
+    }
+
+    WalkForward walk_forward(config, [&base_path](const std::string &file) {
+        return load_day(base_path, file);
+    }, std::make_shared<FeatureStore>());
+
+    std::vector<int64_t> totals(config.thresholds_.size(), 0);
+    for (const auto &day : walk_forward.run()) {
+        std::cout << day.file_ << " r2 " << std::fixed << std::setprecision(4)
+                  << day.fit_.r2_;
+        for (size_t i = 0; i < day.results_.size(); ++i) {
+            totals[i] += day.results_[i].pnl_;
+            std::cout << "  thr " << config.thresholds_[i] << ": "
+                      << day.results_[i].pnl_;
+        }
+        std::cout << "\n";
+    }
+    std::cout << "total";
+    for (size_t i = 0; i < totals.size(); ++i) {
+        std::cout << "  thr " << config.thresholds_[i] << ": " << totals[i];
+    }
+    std::cout << "\n";
+}
 
+int main() {
+    try {
         std::map<std::string, std::pair<std::string, std::string>> instruments = {
                 {"es", {"E-mini S&P 500",    "ESU4"}},
                 {"nq", {"E-mini NASDAQ-100", "MNQU4"}}
@@ -62,6 +131,12 @@ int main() {
             throw std::runtime_error("invalid strategy selection");
         }
 
+        std::cout << "log trades to console, csv and database (y/n)? ";
+        char log_trades;
+        std::cin >> log_trades;
+        auto multi_backtest = std::make_unique<ConcurrentBacktester>(
+                log_trades == 'y' ? LogConfig{} : LogConfig::offline());
+
         const std::filesystem::path base_path = std::filesystem::current_path()  / ".." / "data";
         auto data_files = get_available_data_files();
 
@@ -79,6 +154,45 @@ int main() {
                     continue;
                 }
 
+                if (strategy_index == 1) {
+                    std::cout << "walk forward over all " << name << " files (y/n)? ";
+                    char walk;
+                    std::cin >> walk;
+                    if (walk == 'y') {
+                        run_walk_forward(prefix, instrument_files, base_path);
+                        continue;
+                    }
+                }
+
+                std::cout << "replay all " << name << " files day-parallel (y/n)? ";
+                char parallel;
+                std::cin >> parallel;
+                if (parallel == 'y') {
+                    std::cout << "carry positions overnight (y/n)? ";
+                    char carry;
+                    std::cin >> carry;
+
+                    DayParallelConfig config;
+                    config.instrument_id_ = prefix;
+                    config.files_ = instrument_files;
+                    config.strategy_index_ = strategy_index;
+                    config.carry_ = carry == 'y' ? CarryPolicy::CARRY_TO_OPEN
+                                                 : CarryPolicy::FLATTEN;
+                    config.train_on_previous_day_ = strategy_index != 0;
+
+                    auto result = multi_backtest->run_day_parallel(
+                            config, [&base_path](const std::string &file) {
+                                return load_day(base_path, file);
+                            });
+                    for (size_t i = 0; i < result.days_.size(); ++i) {
+                        std::cout << result.days_[i].file_ << " pnl "
+                                  << result.day_pnl_[i] << " close position "
+                                  << result.days_[i].position_ << "\n";
+                    }
+                    std::cout << name << " total pnl " << result.total_pnl_ << "\n";
+                    continue;
+                }
+
                 std::cout << "\navailable " << name << " files:\n";
                 for (size_t i = 0; i < instrument_files.size(); ++i) {
                     std::cout << i + 1 << ". " << instrument_files[i] << "\n";
@@ -93,33 +207,36 @@ int main() {
                 }
 
                 std::string backtest_file = instrument_files[backtest_file_idx - 1];
-                std::cout << "parsing backtest data for " << name << "...\n";
-                auto data_parser = std::make_unique<Parser>(
-                        (base_path / backtest_file).string());
-                data_parser->parse();
+                std::cout << "loading backtest data for " << name << "...\n";
+                auto messages = load_day(base_path, backtest_file);
 
-                std::vector<book_message> train_messages;
+                std::shared_ptr<const MessageStore> train_messages;
                 std::string train_file;
-                if (strategy_index == 1) {  // linear_model_strat needs training data
-                    std::cout << "select training file: ";
+                // linear_model_strat needs training data, the online variant
+                // only uses it as a warm start
+                const bool online = strategy_index == 2;
+                if (strategy_index == 1 || online) {
+                    std::cout << (online ? "select training file (0 to skip): "
+                                         : "select training file: ");
                     size_t train_file_idx;
                     std::cin >> train_file_idx;
 
-                    if (train_file_idx < 1 || train_file_idx > instrument_files.size()) {
-                        throw std::runtime_error("invalid training file selection");
-                    }
+                    if (online && train_file_idx == 0) {
+                        std::cout << "skipping training for " << name << "\n";
+                    } else {
+                        if (train_file_idx < 1 || train_file_idx > instrument_files.size()) {
+                            throw std::runtime_error("invalid training file selection");
+                        }
 
-                    train_file = instrument_files[train_file_idx - 1];
-                    std::cout << "parsing training data for " << name << "...\n";
-                    auto train_parser = std::make_unique<Parser>(
-                            (base_path / train_file).string());
-                    train_parser->parse();
-                    train_messages = std::move(train_parser->message_stream_);
+                        train_file = instrument_files[train_file_idx - 1];
+                        std::cout << "loading training data for " << name << "...\n";
+                        train_messages = load_day(base_path, train_file);
+                    }
                 }
 
                 multi_backtest->add_instrument(
                         prefix,
-                        std::move(data_parser->message_stream_),
+                        std::move(messages),
                         std::move(train_messages),
                         backtest_file,
                         train_file
@@ -1,13 +1,16 @@
 #include "../include/market_data_ingestor.h"
+#include "../include/tsc_clock.h"
 #include "book/orderbook.h"
 #include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <pthread.h>
+#include <string>
 
 using SteadyClock = std::chrono::steady_clock;
 
-MarketDataIngestor::MarketDataIngestor(std::vector<book_message> msgs) {
+MarketDataIngestor::MarketDataIngestor(std::vector<book_message> msgs,
+                                       bool instrumented) {
   int32_t min_px = INT32_MAX, max_px = INT32_MIN;
   for (const auto &m : msgs) {
     if (m.price_ < 99 || m.price_ > 10'000'00) {
@@ -19,6 +22,11 @@ MarketDataIngestor::MarketDataIngestor(std::vector<book_message> msgs) {
   std::cout << "price window: " << min_px << " … " << max_px << '\n';
   orderbook_ = std::make_unique<Orderbook>(min_px, max_px);
   messages_ = std::move(msgs);
+  if (instrumented) {
+    latency_ = std::make_unique<Histograms>();
+    // calibrate before the replay rather than inside it
+    TscClock::ns_per_tick();
+  }
 }
 
 MarketDataIngestor::~MarketDataIngestor() { stop(); }
@@ -33,7 +41,11 @@ void MarketDataIngestor::start() {
   unsigned cpu = 3;
   injestor_thread_ = std::thread([this, cpu] {
     pin_cpu(cpu);
-    ingest_market_data();
+    if (latency_) {
+      ingest_market_data<true>();
+    } else {
+      ingest_market_data<false>();
+    }
   });
 }
 
@@ -94,17 +106,31 @@ void MarketDataIngestor::print_performance_stats() const {
             << '\n';
 }
 
+template <bool Instrumented>
 void MarketDataIngestor::ingest_market_data() {
   std::cout << "market data ingestion thread started\n";
   uint64_t processed = 0;
 
+  std::unique_ptr<PerfCounters> counters;
+  if (count_events_) {
+    counters = std::make_unique<PerfCounters>();
+    event_error_ = counters->error();
+    counters->start();
+  }
   start_perf_tracking();
 
   for (const auto &msg : messages_) {
     if (!running_.load(std::memory_order_relaxed)) {
       break;
     }
-    orderbook_->process_msg(msg);
+    if constexpr (Instrumented) {
+      const uint64_t begin = TscClock::start();
+      orderbook_->process_msg(msg);
+      const uint64_t end = TscClock::stop();
+      (*latency_)[histogram_index(msg.action_, msg.side_)].record(end - begin);
+    } else {
+      orderbook_->process_msg(msg);
+    }
     ++processed;
     // if (processed == 1'000'000)
     // {
@@ -116,10 +142,61 @@ void MarketDataIngestor::ingest_market_data() {
     // }
      //std::cout << orderbook_->get_formatted_time_fast() << std::endl;
   }
+  if (counters) {
+    event_counts_ = counters->stop();
+  }
   end_perf_tracking(processed);
   std::cout << "market data ingestion completed\n";
 }
 
+const LatencyHistogram &MarketDataIngestor::latency(char action,
+                                                    bool side) const {
+  static const LatencyHistogram empty;
+  return latency_ ? (*latency_)[histogram_index(action, side)] : empty;
+}
+
+void MarketDataIngestor::print_latency_stats() const {
+  if (!latency_) {
+    std::cout << "latency not recorded, ingestor is not instrumented\n";
+    return;
+  }
+  std::cout << "Latency (ns)      count      p50      p99    p99.9      max\n"
+            << std::fixed << std::setprecision(0);
+  for (size_t i = 0; i < latency_->size(); ++i) {
+    const LatencyHistogram &h = (*latency_)[i];
+    if (h.count() == 0) {
+      continue;
+    }
+    const std::string name =
+        std::string(ACTION_NAMES[i / 2]) + (i % 2 ? " bid" : " ask");
+    std::cout << std::left << std::setw(12) << name << std::right
+              << std::setw(11) << h.count() << std::setw(9)
+              << TscClock::to_ns(h.value_at(0.5)) << std::setw(9)
+              << TscClock::to_ns(h.value_at(0.99)) << std::setw(9)
+              << TscClock::to_ns(h.value_at(0.999)) << std::setw(9)
+              << TscClock::to_ns(h.max()) << '\n';
+  }
+}
+
+void MarketDataIngestor::dump_latency_histograms(std::ostream &out) const {
+  if (!latency_) {
+    return;
+  }
+  out << "action,side,low_ns,high_ns,count\n";
+  for (size_t i = 0; i < latency_->size(); ++i) {
+    const LatencyHistogram &h = (*latency_)[i];
+    for (size_t b = 0; b < LatencyHistogram::BUCKETS; ++b) {
+      if (h.count_at(b) == 0) {
+        continue;
+      }
+      out << ACTION_NAMES[i / 2] << ',' << (i % 2 ? "bid" : "ask") << ','
+          << TscClock::to_ns(LatencyHistogram::lowest(b)) << ','
+          << TscClock::to_ns(LatencyHistogram::highest(b)) << ','
+          << h.count_at(b) << '\n';
+    }
+  }
+}
+
 void MarketDataIngestor::pin_cpu(unsigned cpu_id) {
   cpu_set_t mask;
   CPU_ZERO(&mask);
@@ -0,0 +1,71 @@
+#include "../include/merged_replay.h"
+#include <stdexcept>
+
+size_t MergedReplay::add_instrument(const std::string &instrument_id,
+                                    std::vector<book_message> &&messages) {
+  return add_instrument(instrument_id, MessageStore::adopt(std::move(messages)));
+}
+
+size_t
+MergedReplay::add_instrument(const std::string &instrument_id,
+                             std::shared_ptr<const MessageStore> messages) {
+  if (instruments_.size() == StreamMerger::MAX_STREAMS) {
+    throw std::runtime_error("merged replay supports at most 16 instruments");
+  }
+  auto instrument = std::make_unique<Instrument>();
+  instrument->id_ = instrument_id;
+  instrument->messages_ = std::move(messages);
+  instrument->book_ = std::make_unique<Orderbook>(100, 7000000);
+  instruments_.push_back(std::move(instrument));
+  return instruments_.size() - 1;
+}
+
+void MergedReplay::set_session(uint64_t start_ns, uint64_t end_ns) {
+  start_ns_ = start_ns;
+  end_ns_ = end_ns;
+}
+
+void MergedReplay::run() {
+  if (instruments_.empty()) {
+    return;
+  }
+
+  std::array<std::span<const book_message>, StreamMerger::MAX_STREAMS>
+      streams{};
+  std::array<Instrument *, StreamMerger::MAX_STREAMS> route{};
+  for (size_t i = 0; i < instruments_.size(); ++i) {
+    streams[i] = instruments_[i]->messages_->messages();
+    route[i] = instruments_[i].get();
+  }
+  StreamMerger merger(std::span(streams.data(), instruments_.size()));
+
+  running_ = true;
+  size_t idx;
+  const book_message *first;
+  while (running_) {
+    const size_t n = merger.next_run(idx, first);
+    if (n == 0) {
+      break;
+    }
+    Instrument &instrument = *route[idx];
+    Orderbook &book = *instrument.book_;
+    for (const book_message *msg = first; msg != first + n; ++msg) {
+      timers_.advance(msg->time_);
+      book.process_msg(*msg);
+      if (msg->time_ >= start_ns_) {
+        instrument.samplers_.on_message(*msg, book);
+        if (strategy_) {
+          strategy_->on_message(idx, *msg);
+        }
+      }
+      if (msg->time_ >= end_ns_) {
+        if (strategy_) {
+          strategy_->close_positions();
+        }
+        running_ = false;
+        break;
+      }
+    }
+  }
+  running_ = false;
+}
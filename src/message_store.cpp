@@ -0,0 +1,196 @@
+#include "../include/message_store.h"
+#include "../include/feature_store.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+constexpr char STORE_MAGIC[4] = {'M', 'S', 'G', 'S'};
+constexpr uint32_t STORE_VERSION = 2;
+constexpr size_t HEADER_BYTES = 64;
+constexpr size_t HUGE_PAGE_BYTES = 2 * 1024 * 1024;
+
+struct StoreHeader {
+  char magic_[4];
+  uint32_t version_;
+  uint32_t record_size_;
+  uint32_t reserved_;
+  uint64_t count_;
+  // size and mtime of the file the records were parsed from, 0 if none
+  uint64_t source_size_;
+  int64_t source_mtime_ns_;
+};
+static_assert(sizeof(StoreHeader) <= HEADER_BYTES);
+static_assert(HEADER_BYTES % alignof(book_message) == 0);
+
+bool source_stamp(const std::filesystem::path &source, uint64_t &size,
+                  int64_t &mtime_ns) {
+  struct stat st{};
+  if (stat(source.c_str(), &st) == -1) {
+    return false;
+  }
+  size = static_cast<uint64_t>(st.st_size);
+  mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1'000'000'000 +
+             st.st_mtim.tv_nsec;
+  return true;
+}
+} // namespace
+
+std::shared_ptr<const MessageStore>
+MessageStore::adopt(std::vector<book_message> &&messages) {
+  std::shared_ptr<MessageStore> store(new MessageStore());
+  store->owned_ = std::move(messages);
+  store->data_ = store->owned_.data();
+  store->size_ = store->owned_.size();
+  return store;
+}
+
+std::shared_ptr<const MessageStore>
+MessageStore::copy_to_hugepages(std::span<const book_message> messages) {
+  std::shared_ptr<MessageStore> store(new MessageStore());
+  if (messages.empty()) {
+    return store;
+  }
+
+  const size_t bytes = (messages.size_bytes() + HUGE_PAGE_BYTES - 1) /
+                       HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+  void *mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (mem == MAP_FAILED) {
+    mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+      throw std::runtime_error("failed to map message store: " +
+                               std::string(strerror(errno)));
+    }
+    madvise(mem, bytes, MADV_HUGEPAGE);
+  }
+  std::memcpy(mem, messages.data(), messages.size_bytes());
+  mprotect(mem, bytes, PROT_READ);
+
+  store->mapping_ = mem;
+  store->mapping_bytes_ = bytes;
+  store->data_ = static_cast<const book_message *>(mem);
+  store->size_ = messages.size();
+  return store;
+}
+
+std::shared_ptr<const MessageStore>
+MessageStore::map_file(const std::filesystem::path &path,
+                       const std::filesystem::path &source) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    throw std::runtime_error("failed to open message store " + path.string() +
+                             ": " + strerror(errno));
+  }
+  struct stat st{};
+  if (fstat(fd, &st) == -1 ||
+      static_cast<size_t>(st.st_size) < HEADER_BYTES) {
+    close(fd);
+    throw std::runtime_error("message store too small: " + path.string());
+  }
+
+  const auto bytes = static_cast<size_t>(st.st_size);
+  void *mem = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mem == MAP_FAILED) {
+    throw std::runtime_error("failed to map message store: " +
+                             std::string(strerror(errno)));
+  }
+
+  StoreHeader h{};
+  std::memcpy(&h, mem, sizeof(h));
+  if (std::memcmp(h.magic_, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0 ||
+      h.version_ != STORE_VERSION || h.record_size_ != sizeof(book_message) ||
+      HEADER_BYTES + h.count_ * sizeof(book_message) > bytes) {
+    munmap(mem, bytes);
+    throw std::runtime_error("bad message store header: " + path.string());
+  }
+  if (!source.empty()) {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    if (!source_stamp(source, size, mtime_ns) || h.source_size_ != size ||
+        h.source_mtime_ns_ != mtime_ns) {
+      munmap(mem, bytes);
+      throw std::runtime_error("message store out of date with " +
+                               source.string() + ": " + path.string());
+    }
+  }
+  madvise(mem, bytes, MADV_SEQUENTIAL);
+
+  std::shared_ptr<MessageStore> store(new MessageStore());
+  store->mapping_ = mem;
+  store->mapping_bytes_ = bytes;
+  store->data_ = reinterpret_cast<const book_message *>(
+      static_cast<const std::byte *>(mem) + HEADER_BYTES);
+  store->size_ = h.count_;
+  return store;
+}
+
+void MessageStore::save(const std::filesystem::path &path,
+                        std::span<const book_message> messages,
+                        const std::filesystem::path &source) {
+  StoreHeader h{};
+  if (!source.empty() &&
+      !source_stamp(source, h.source_size_, h.source_mtime_ns_)) {
+    throw std::runtime_error("failed to stat message source " +
+                             source.string() + ": " + strerror(errno));
+  }
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path());
+  }
+  const auto tmp = path.string() + ".tmp";
+  int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd == -1) {
+    throw std::runtime_error("failed to create message store: " +
+                             std::string(strerror(errno)));
+  }
+
+  std::byte header[HEADER_BYTES]{};
+  std::memcpy(h.magic_, STORE_MAGIC, sizeof(STORE_MAGIC));
+  h.version_ = STORE_VERSION;
+  h.record_size_ = sizeof(book_message);
+  h.count_ = messages.size();
+  std::memcpy(header, &h, sizeof(h));
+
+  auto write_all = [fd](const void *buf, size_t len) {
+    auto *p = static_cast<const char *>(buf);
+    while (len > 0) {
+      ssize_t n = ::write(fd, p, len);
+      if (n < 0) {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      p += n;
+      len -= static_cast<size_t>(n);
+    }
+    return true;
+  };
+
+  const bool ok = write_all(header, HEADER_BYTES) &&
+                  write_all(messages.data(), messages.size_bytes());
+  close(fd);
+  if (!ok) {
+    std::filesystem::remove(tmp);
+    throw std::runtime_error("failed to write message store: " +
+                             std::string(strerror(errno)));
+  }
+  std::filesystem::rename(tmp, path);
+}
+
+MessageStore::~MessageStore() {
+  if (mapping_) {
+    munmap(mapping_, mapping_bytes_);
+  }
+}
+
+uint64_t MessageStore::hash() const {
+  std::call_once(hash_once_,
+                 [this] { hash_ = FeatureStore::hash_messages(messages()); });
+  return hash_;
+}
@@ -0,0 +1,157 @@
+#include "../include/mmap_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+size_t page_size() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+} // namespace
+
+SegmentedMmapWriter::SegmentedMmapWriter(std::filesystem::path path,
+                                         size_t segment_bytes,
+                                         uint64_t max_file_bytes,
+                                         std::string header)
+    : path_(std::move(path)),
+      // mappings start on page boundaries, so segments are whole pages
+      segment_bytes_((std::max(segment_bytes, page_size()) + page_size() - 1) /
+                     page_size() * page_size()),
+      max_file_bytes_(max_file_bytes), header_(std::move(header)) {
+  if (header_.size() >= segment_bytes_) {
+    throw std::runtime_error("log header larger than a segment");
+  }
+  open_file();
+}
+
+SegmentedMmapWriter::~SegmentedMmapWriter() {
+  // a failed truncate leaves the file padded past what was written; that is
+  // all close() can report, and it must not escape a destructor
+  try {
+    close();
+  } catch (const std::exception &) {
+  }
+}
+
+void SegmentedMmapWriter::open_file() {
+  current_path_ = path_;
+  if (file_index_ > 0) {
+    current_path_.replace_filename(path_.stem().string() + "." +
+                                   std::to_string(file_index_) +
+                                   path_.extension().string());
+  }
+  fd_ = ::open(current_path_.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+               S_IRUSR | S_IWUSR);
+  if (fd_ == -1) {
+    throw std::runtime_error("failed to open log file " +
+                             current_path_.string() + ": " + strerror(errno));
+  }
+  synced_ = 0;
+  map_segment(0);
+  write(header_.data(), header_.size());
+}
+
+void SegmentedMmapWriter::map_segment(uint64_t file_offset) {
+  if (ftruncate(fd_, static_cast<off_t>(file_offset + segment_bytes_)) == -1) {
+    throw std::runtime_error("failed to extend log file: " +
+                             std::string(strerror(errno)));
+  }
+  void *mem = mmap(nullptr, segment_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED,
+                   fd_, static_cast<off_t>(file_offset));
+  if (mem == MAP_FAILED) {
+    throw std::runtime_error("failed to map log segment: " +
+                             std::string(strerror(errno)));
+  }
+  segment_ = static_cast<char *>(mem);
+  capacity_ = segment_bytes_;
+  segment_start_ = file_offset;
+  offset_ = 0;
+}
+
+void SegmentedMmapWriter::unmap_segment() {
+  if (segment_) {
+    flush();
+    munmap(segment_, segment_bytes_);
+    segment_ = nullptr;
+    capacity_ = 0;
+    segment_start_ += offset_;
+    offset_ = 0;
+  }
+}
+
+void SegmentedMmapWriter::close_file() {
+  if (fd_ == -1) {
+    return;
+  }
+  const uint64_t length = size();
+  unmap_segment();
+  // drop the unwritten tail of the last segment
+  if (ftruncate(fd_, static_cast<off_t>(length)) == -1) {
+    ::close(fd_);
+    fd_ = -1;
+    throw std::runtime_error("failed to truncate log file: " +
+                             std::string(strerror(errno)));
+  }
+  ::close(fd_);
+  fd_ = -1;
+}
+
+void SegmentedMmapWriter::write_slow(const char *data, size_t size) {
+  if (fd_ == -1) {
+    throw std::runtime_error("write to closed log file");
+  }
+  // files end on the segment boundary at or past max_file_bytes_. a write
+  // that would cross it starts the next file instead of being split across
+  // two; one too large for a fresh file runs on past the boundary
+  const uint64_t file_limit =
+      (max_file_bytes_ + segment_bytes_ - 1) / segment_bytes_ * segment_bytes_;
+  if (max_file_bytes_ && this->size() + size > file_limit &&
+      this->size() > header_.size()) {
+    close_file();
+    ++file_index_;
+    open_file();
+  }
+  while (size > 0) {
+    if (offset_ == capacity_) {
+      const uint64_t next = segment_start_ + segment_bytes_;
+      unmap_segment();
+      map_segment(next);
+      continue;
+    }
+    const size_t n = std::min(size, capacity_ - offset_);
+    std::memcpy(segment_ + offset_, data, n);
+    offset_ += n;
+    data += n;
+    size -= n;
+  }
+  // a full file takes nothing more on the fast path; the next write comes
+  // back here and rolls over
+  if (max_file_bytes_ && this->size() >= file_limit) {
+    capacity_ = offset_;
+  }
+}
+
+void SegmentedMmapWriter::flush() {
+  if (!segment_) {
+    return;
+  }
+  const uint64_t end = size();
+  if (end <= synced_) {
+    return;
+  }
+  // the dirty range may start in an earlier, already unmapped segment; that
+  // part was flushed when the segment was unmapped
+  const uint64_t from = std::max(synced_, segment_start_);
+  const uint64_t page_from = from / page_size() * page_size();
+  msync(segment_ + (page_from - segment_start_), end - page_from, MS_ASYNC);
+  sync_file_range(fd_, static_cast<off_t>(page_from),
+                  static_cast<off_t>(end - page_from), SYNC_FILE_RANGE_WRITE);
+  synced_ = end;
+}
+
+void SegmentedMmapWriter::close() { close_file(); }
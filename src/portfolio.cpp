@@ -0,0 +1,202 @@
+#include "../include/portfolio.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+void PortfolioAggregator::Producer::publish(const Event &event) {
+  // a full queue needs no wake, the aggregator has work already
+  while (!backlog_.empty()) {
+    if (!queue_.try_push(backlog_.front())) {
+      backlog_.push_back(event);
+      return;
+    }
+    backlog_.pop_front();
+  }
+  if (!queue_.try_push(event)) {
+    backlog_.push_back(event);
+    return;
+  }
+  wait_->notify();
+}
+
+void PortfolioAggregator::Producer::mark(uint64_t time_ns, int64_t pnl,
+                                         int position, int32_t price,
+                                         int32_t point_value) {
+  publish({time_ns, pnl, position, price, point_value, Event::MARK});
+}
+
+void PortfolioAggregator::Producer::fill(uint64_t time_ns, int position,
+                                         int32_t price, int32_t point_value) {
+  publish({time_ns, 0, position, price, point_value, Event::FILL});
+}
+
+void PortfolioAggregator::Producer::finish() {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  backlog_.push_back({UINT64_MAX, 0, 0, 0, 0, Event::DONE});
+  while (!backlog_.empty()) {
+    if (queue_.try_push(backlog_.front())) {
+      backlog_.pop_front();
+      wait_->notify();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+PortfolioAggregator::~PortfolioAggregator() {
+  stop_ = true;
+  wait_.wake();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+PortfolioAggregator::Producer &
+PortfolioAggregator::add_instrument(const std::string &instrument_id) {
+  if (thread_.joinable()) {
+    throw std::runtime_error("portfolio instruments must be added before start");
+  }
+  Lane lane;
+  lane.id_ = instrument_id;
+  lane.producer_ = std::make_unique<Producer>();
+  lane.producer_->wait_ = &wait_;
+  lanes_.push_back(std::move(lane));
+  return *lanes_.back().producer_;
+}
+
+void PortfolioAggregator::start() {
+  result_ = PortfolioResult{};
+  stop_ = false;
+  thread_ = std::thread(&PortfolioAggregator::run, this);
+}
+
+PortfolioResult PortfolioAggregator::finish() {
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  for (const auto &lane : lanes_) {
+    result_.instruments_.push_back(lane.id_);
+    result_.instrument_pnl_.push_back(lane.pnl_);
+  }
+  return std::move(result_);
+}
+
+bool PortfolioAggregator::drain() {
+  bool progress = false;
+  for (auto &lane : lanes_) {
+    if (lane.next_ == lane.pending_.size()) {
+      lane.pending_.clear();
+      lane.next_ = 0;
+    }
+    Event event;
+    while (lane.producer_->queue_.try_pop(event)) {
+      progress = true;
+      if (event.kind_ == Event::DONE) {
+        lane.done_ = true;
+        break;
+      }
+      lane.seen_ns_ = event.time_;
+      lane.pending_.push_back(event);
+    }
+  }
+  return progress;
+}
+
+bool PortfolioAggregator::has_events() const {
+  for (const auto &lane : lanes_) {
+    if (!lane.producer_->queue_.empty()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void PortfolioAggregator::apply(Lane &lane, const Event &event) {
+  const int64_t exposure = static_cast<int64_t>(event.position_) *
+                           event.price_ * event.point_value_;
+  PortfolioPoint &point = current_;
+  if (event.kind_ == Event::MARK) {
+    point.pnl_ += event.pnl_ - lane.pnl_;
+    lane.pnl_ = event.pnl_;
+  }
+  point.net_exposure_ += exposure - lane.exposure_;
+  point.gross_exposure_ += std::abs(exposure) - std::abs(lane.exposure_);
+  lane.exposure_ = exposure;
+  point.time_ = event.time_;
+}
+
+void PortfolioAggregator::commit() {
+  result_.curve_.push_back(current_);
+  result_.metrics_.on_mark(current_.time_, current_.pnl_);
+  result_.max_gross_exposure_ =
+      std::max(result_.max_gross_exposure_, current_.gross_exposure_);
+}
+
+void PortfolioAggregator::run() {
+  bool dirty = false;
+  current_ = PortfolioPoint{};
+
+  while (true) {
+    const bool drained = drain();
+
+    // nothing earlier than the watermark can still arrive
+    uint64_t watermark = UINT64_MAX;
+    bool all_done = true;
+    for (const auto &lane : lanes_) {
+      if (!lane.done_) {
+        all_done = false;
+        watermark = std::min(watermark, lane.seen_ns_);
+      }
+    }
+
+    bool merged = false;
+    while (true) {
+      Lane *next = nullptr;
+      uint64_t next_ns = watermark;
+      for (auto &lane : lanes_) {
+        if (lane.next_ < lane.pending_.size() &&
+            lane.pending_[lane.next_].time_ <= next_ns &&
+            (!next || lane.pending_[lane.next_].time_ < next_ns)) {
+          next = &lane;
+          next_ns = lane.pending_[lane.next_].time_;
+        }
+      }
+      if (!next) {
+        break;
+      }
+      const Event &event = next->pending_[next->next_++];
+      // one point per simulated timestamp, closed once time moves past it
+      if (dirty && event.time_ != current_.time_) {
+        commit();
+      }
+      apply(*next, event);
+      dirty = true;
+      merged = true;
+    }
+
+    if (all_done) {
+      bool pending = false;
+      for (const auto &lane : lanes_) {
+        pending |= lane.next_ < lane.pending_.size();
+      }
+      if (!pending) {
+        break;
+      }
+      continue;
+    }
+    if (stop_) {
+      break;
+    }
+    if (!drained && !merged) {
+      // the watermark only moves when an instrument publishes
+      wait_.wait([this] { return stop_ || has_events(); });
+    }
+  }
+
+  if (dirty) {
+    commit();
+  }
+}
@@ -0,0 +1,182 @@
+#include "../include/regression_grid.h"
+#include <algorithm>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+constexpr size_t BLOCK_ROWS = 4096;
+constexpr size_t MIN_ROWS_PER_THREAD = 16384;
+} // namespace
+
+GridStats &GridStats::operator+=(const GridStats &other) {
+  if (other.rows_ == 0) {
+    return *this;
+  }
+  if (rows_ == 0) {
+    *this = other;
+    return *this;
+  }
+  if (other.max_lag_ != max_lag_ || other.horizons_ != horizons_) {
+    throw std::runtime_error("grid stats shape mismatch");
+  }
+  gram_ += other.gram_;
+  xty_ += other.xty_;
+  yty_ += other.yty_;
+  rows_ += other.rows_;
+  return *this;
+}
+
+RegressionGrid::RegressionGrid(int max_lag, std::vector<int> horizons,
+                               unsigned threads)
+    : max_lag_(max_lag), horizons_(std::move(horizons)),
+      threads_(threads ? threads
+                       : std::max(1u, std::thread::hardware_concurrency())) {
+  if (max_lag_ < 0 || horizons_.empty()) {
+    throw std::runtime_error("regression grid needs a lag and a horizon");
+  }
+  for (int h : horizons_) {
+    if (h <= 0) {
+      throw std::runtime_error("forecast horizon must be positive");
+    }
+  }
+  max_horizon_ = *std::max_element(horizons_.begin(), horizons_.end());
+}
+
+GridStats RegressionGrid::empty_stats() const {
+  const int p = max_lag_ + 2;
+  const auto h = static_cast<Eigen::Index>(horizons_.size());
+  GridStats stats;
+  stats.max_lag_ = max_lag_;
+  stats.horizons_ = horizons_;
+  stats.gram_ = Eigen::MatrixXd::Zero(p, p);
+  stats.xty_ = Eigen::MatrixXd::Zero(p, h);
+  stats.yty_ = Eigen::VectorXd::Zero(h);
+  return stats;
+}
+
+GridStats RegressionGrid::accumulate(std::span<const int32_t> voi,
+                                     std::span<const int32_t> mid) const {
+  const size_t n = std::min(voi.size(), mid.size());
+  GridStats stats = empty_stats();
+  if (n <= static_cast<size_t>(max_lag_ + max_horizon_)) {
+    return stats;
+  }
+
+  // prefix[k] = mid[0] + ... + mid[k - 1]
+  std::vector<int64_t> prefix(n + 1, 0);
+  for (size_t i = 0; i < n; ++i) {
+    prefix[i + 1] = prefix[i] + mid[i];
+  }
+
+  // rows t in [max_lag, n - 1 - max_horizon] so every horizon is defined
+  const size_t first = static_cast<size_t>(max_lag_);
+  const size_t last = n - static_cast<size_t>(max_horizon_);
+  const int p = max_lag_ + 2;
+  const auto nh = static_cast<Eigen::Index>(horizons_.size());
+
+  auto run = [&, p, nh](size_t begin, size_t end) {
+    GridStats part = empty_stats();
+    Eigen::MatrixXd X(BLOCK_ROWS, p);
+    Eigen::MatrixXd Y(BLOCK_ROWS, nh);
+    for (size_t block = begin; block < end; block += BLOCK_ROWS) {
+      const auto rows =
+          static_cast<Eigen::Index>(std::min(BLOCK_ROWS, end - block));
+      for (Eigen::Index r = 0; r < rows; ++r) {
+        const size_t t = block + static_cast<size_t>(r);
+        X(r, 0) = 1.0;
+        for (int j = 0; j <= max_lag_; ++j) {
+          X(r, j + 1) = static_cast<double>(voi[t - j]);
+        }
+        for (Eigen::Index h = 0; h < nh; ++h) {
+          const int horizon = horizons_[static_cast<size_t>(h)];
+          const int64_t window = prefix[t + horizon + 1] - prefix[t + 1];
+          Y(r, h) = static_cast<double>(window) / horizon -
+                    static_cast<double>(mid[t]);
+        }
+      }
+      const auto Xb = X.topRows(rows);
+      const auto Yb = Y.topRows(rows);
+      part.gram_.selfadjointView<Eigen::Lower>().rankUpdate(Xb.transpose());
+      part.xty_.noalias() += Xb.transpose() * Yb;
+      part.yty_ += Yb.colwise().squaredNorm().transpose();
+    }
+    part.gram_ = part.gram_.selfadjointView<Eigen::Lower>();
+    part.rows_ = end - begin;
+    return part;
+  };
+
+  const size_t total = last - first;
+  const size_t workers = std::clamp<size_t>(total / MIN_ROWS_PER_THREAD, 1,
+                                            threads_);
+  if (workers == 1) {
+    return run(first, last);
+  }
+
+  std::vector<std::future<GridStats>> futures;
+  const size_t chunk = (total + workers - 1) / workers;
+  for (size_t begin = first; begin < last; begin += chunk) {
+    const size_t end = std::min(begin + chunk, last);
+    futures.emplace_back(std::async(std::launch::async, run, begin, end));
+  }
+  for (auto &f : futures) {
+    stats += f.get();
+  }
+  return stats;
+}
+
+GridFit RegressionGrid::solve(const GridStats &stats, int lag,
+                              size_t horizon_idx) const {
+  GridFit fit;
+  fit.lag_ = lag;
+  fit.horizon_ = stats.horizons_.at(horizon_idx);
+  fit.rows_ = stats.rows_;
+  const int p = lag + 2;
+  fit.coefficients_.assign(p, 0.0);
+  if (lag > stats.max_lag_ || stats.rows_ <= static_cast<size_t>(p)) {
+    return fit;
+  }
+
+  const auto idx = static_cast<Eigen::Index>(horizon_idx);
+  const Eigen::MatrixXd G = stats.gram_.topLeftCorner(p, p);
+  const Eigen::VectorXd b = stats.xty_.col(idx).head(p);
+  const Eigen::VectorXd w = G.ldlt().solve(b);
+
+  const double n = static_cast<double>(stats.rows_);
+  const double yty = stats.yty_(idx);
+  const double y_sum = b(0);
+  const double sst = yty - y_sum * y_sum / n;
+  fit.sse_ = std::max(0.0, yty - w.dot(b));
+  fit.r2_ = sst > 0.0 ? 1.0 - fit.sse_ / sst : 0.0;
+  std::copy(w.data(), w.data() + p, fit.coefficients_.begin());
+  return fit;
+}
+
+std::vector<GridFit> RegressionGrid::solve_all(const GridStats &stats) const {
+  const size_t lags = static_cast<size_t>(stats.max_lag_) + 1;
+  const size_t cells = lags * stats.horizons_.size();
+  std::vector<GridFit> fits(cells);
+
+  auto run = [&](size_t begin, size_t end) {
+    for (size_t c = begin; c < end; ++c) {
+      fits[c] = solve(stats, static_cast<int>(c % lags), c / lags);
+    }
+  };
+
+  const size_t workers = std::clamp<size_t>(cells / 64, 1, threads_);
+  if (workers == 1) {
+    run(0, cells);
+    return fits;
+  }
+
+  std::vector<std::future<void>> futures;
+  const size_t chunk = (cells + workers - 1) / workers;
+  for (size_t begin = 0; begin < cells; begin += chunk) {
+    futures.emplace_back(std::async(std::launch::async, run, begin,
+                                    std::min(begin + chunk, cells)));
+  }
+  for (auto &f : futures) {
+    f.wait();
+  }
+  return fits;
+}
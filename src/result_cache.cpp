@@ -0,0 +1,208 @@
+#include "../include/result_cache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <xxhash.h>
+
+namespace {
+constexpr char RESULT_MAGIC[4] = {'B', 'R', 'E', 'S'};
+constexpr uint32_t RESULT_VERSION = 3;
+constexpr size_t HEADER_BYTES = 64;
+
+struct ResultHeader {
+  char magic_[4];
+  uint32_t version_;
+  uint32_t key_bytes_;
+  uint32_t file_bytes_;
+  uint64_t trades_;
+  uint64_t points_;
+};
+static_assert(sizeof(ResultHeader) <= HEADER_BYTES);
+static_assert(std::is_trivially_copyable_v<StrategyMetrics>);
+
+// the summary is stored widened to fixed 64 bit fields so the layout does
+// not follow DayResult's
+struct SummaryRecord {
+  int64_t pnl_;
+  int64_t position_;
+  int64_t point_value_;
+  int64_t open_bid_;
+  int64_t open_ask_;
+  int64_t close_bid_;
+  int64_t close_ask_;
+  uint64_t messages_;
+};
+
+void append(std::string &out, const void *data, size_t bytes) {
+  out.append(static_cast<const char *>(data), bytes);
+}
+
+class Reader {
+public:
+  explicit Reader(const std::string &buf) : buf_(buf) {}
+
+  bool read(void *out, size_t bytes) {
+    if (buf_.size() - pos_ < bytes) {
+      return false;
+    }
+    std::memcpy(out, buf_.data() + pos_, bytes);
+    pos_ += bytes;
+    return true;
+  }
+
+  bool read_string(std::string &out, size_t bytes) {
+    if (buf_.size() - pos_ < bytes) {
+      return false;
+    }
+    out.assign(buf_.data() + pos_, bytes);
+    pos_ += bytes;
+    return true;
+  }
+
+  bool done() const { return pos_ == buf_.size(); }
+
+private:
+  const std::string &buf_;
+  size_t pos_ = 0;
+};
+} // namespace
+
+std::string ResultKey::canonical() const {
+  std::ostringstream out;
+  out << "engine=" << ResultCache::ENGINE_VERSION << ";data=" << std::hex
+      << data_hash_ << ";train=" << train_hash_
+      << ";opening=" << opening_hash_ << std::dec
+      << ";session=" << start_ns_ << '-' << end_ns_
+      << ";train_session=" << train_start_ns_ << '-' << train_end_ns_
+      << ";flatten=" << flatten_at_close_ << ";strategy=" << strategy_
+      << ";version=" << version_ << ";params=" << params_;
+  return out.str();
+}
+
+uint64_t ResultKey::hash() const {
+  const std::string key = canonical();
+  return XXH3_64bits(key.data(), key.size());
+}
+
+ResultCache::ResultCache(std::filesystem::path root) : root_(std::move(root)) {}
+
+std::filesystem::path ResultCache::path_for(const ResultKey &key) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.res",
+                static_cast<unsigned long long>(key.hash()));
+  return root_ / name;
+}
+
+std::optional<BacktestResult> ResultCache::open(const ResultKey &key) const {
+  std::ifstream in(path_for(key), std::ios::binary);
+  if (!in) {
+    return std::nullopt;
+  }
+  const std::string buf((std::istreambuf_iterator<char>(in)),
+                        std::istreambuf_iterator<char>());
+
+  Reader reader(buf);
+  std::byte header[HEADER_BYTES];
+  ResultHeader h{};
+  if (!reader.read(header, HEADER_BYTES)) {
+    return std::nullopt;
+  }
+  std::memcpy(&h, header, sizeof(h));
+  if (std::memcmp(h.magic_, RESULT_MAGIC, sizeof(RESULT_MAGIC)) != 0 ||
+      h.version_ != RESULT_VERSION) {
+    return std::nullopt;
+  }
+
+  std::string stored_key;
+  if (!reader.read_string(stored_key, h.key_bytes_) ||
+      stored_key != key.canonical()) {
+    return std::nullopt;
+  }
+
+  BacktestResult result;
+  SummaryRecord s{};
+  if (!reader.read_string(result.summary_.file_, h.file_bytes_) ||
+      !reader.read(&s, sizeof(s)) ||
+      !reader.read(&result.metrics_, sizeof(StrategyMetrics))) {
+    return std::nullopt;
+  }
+  result.summary_.pnl_ = s.pnl_;
+  result.summary_.position_ = static_cast<int>(s.position_);
+  result.summary_.point_value_ = static_cast<int32_t>(s.point_value_);
+  result.summary_.open_bid_ = static_cast<int32_t>(s.open_bid_);
+  result.summary_.open_ask_ = static_cast<int32_t>(s.open_ask_);
+  result.summary_.close_bid_ = static_cast<int32_t>(s.close_bid_);
+  result.summary_.close_ask_ = static_cast<int32_t>(s.close_ask_);
+  result.summary_.messages_ = s.messages_;
+
+  if (h.trades_ > buf.size() / sizeof(TradeRecord) ||
+      h.points_ > buf.size() / sizeof(PnlPoint)) {
+    return std::nullopt;
+  }
+  result.trades_.resize(h.trades_);
+  result.pnl_curve_.resize(h.points_);
+  if (!reader.read(result.trades_.data(), h.trades_ * sizeof(TradeRecord)) ||
+      !reader.read(result.pnl_curve_.data(), h.points_ * sizeof(PnlPoint)) ||
+      !reader.done()) {
+    return std::nullopt;
+  }
+  return result;
+}
+
+void ResultCache::save(const ResultKey &key,
+                       const BacktestResult &result) const {
+  const std::string canonical = key.canonical();
+  const DayResult &day = result.summary_;
+
+  ResultHeader h{};
+  std::memcpy(h.magic_, RESULT_MAGIC, sizeof(RESULT_MAGIC));
+  h.version_ = RESULT_VERSION;
+  h.key_bytes_ = static_cast<uint32_t>(canonical.size());
+  h.file_bytes_ = static_cast<uint32_t>(day.file_.size());
+  h.trades_ = result.trades_.size();
+  h.points_ = result.pnl_curve_.size();
+  std::byte header[HEADER_BYTES]{};
+  std::memcpy(header, &h, sizeof(h));
+
+  const SummaryRecord s{day.pnl_,       day.position_,  day.point_value_,
+                        day.open_bid_,  day.open_ask_,  day.close_bid_,
+                        day.close_ask_, day.messages_};
+
+  std::string buf;
+  buf.reserve(HEADER_BYTES + canonical.size() + day.file_.size() + sizeof(s) +
+              sizeof(StrategyMetrics) +
+              result.trades_.size() * sizeof(TradeRecord) +
+              result.pnl_curve_.size() * sizeof(PnlPoint));
+  append(buf, header, HEADER_BYTES);
+  append(buf, canonical.data(), canonical.size());
+  append(buf, day.file_.data(), day.file_.size());
+  append(buf, &s, sizeof(s));
+  append(buf, &result.metrics_, sizeof(StrategyMetrics));
+  append(buf, result.trades_.data(),
+         result.trades_.size() * sizeof(TradeRecord));
+  append(buf, result.pnl_curve_.data(),
+         result.pnl_curve_.size() * sizeof(PnlPoint));
+
+  // written aside and renamed, so concurrent runs of the same cell never
+  // read a partial file
+  std::filesystem::create_directories(root_);
+  const auto path = path_for(key);
+  const auto tmp =
+      path.string() + ".tmp" +
+      std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+    if (!out) {
+      std::filesystem::remove(tmp);
+      throw std::runtime_error("failed to write result cache " +
+                               path.string());
+    }
+  }
+  std::filesystem::rename(tmp, path);
+}
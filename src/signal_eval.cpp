@@ -0,0 +1,193 @@
+#include "../include/signal_eval.h"
+#include <algorithm>
+#include <future>
+#include <immintrin.h>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+// kernels fill out[lag, k) for the largest k they can cover with full
+// vectors and return k; the caller finishes [k, n) with the scalar loop
+using PredictFn = size_t (*)(const int32_t *, size_t, const double *, size_t,
+                             double *);
+
+void predict_scalar(const int32_t *voi, size_t begin, size_t n,
+                    const double *c, size_t lag, double *out) {
+  for (size_t t = begin; t < n; ++t) {
+    double acc = c[0];
+    for (size_t j = 0; j <= lag; ++j) {
+      acc += c[j + 1] * static_cast<double>(voi[t - j]);
+    }
+    out[t] = acc;
+  }
+}
+
+__attribute__((target("avx2,fma"))) size_t
+predict_avx2(const int32_t *voi, size_t n, const double *c, size_t lag,
+             double *out) {
+  size_t t = lag;
+  const __m256d c0 = _mm256_set1_pd(c[0]);
+  for (; t + 4 <= n; t += 4) {
+    __m256d acc = c0;
+    for (size_t j = 0; j <= lag; ++j) {
+      const __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(voi + t - j));
+      acc = _mm256_fmadd_pd(_mm256_set1_pd(c[j + 1]), _mm256_cvtepi32_pd(v),
+                            acc);
+    }
+    _mm256_storeu_pd(out + t, acc);
+  }
+  return t;
+}
+
+__attribute__((target("avx512f"))) size_t
+predict_avx512(const int32_t *voi, size_t n, const double *c, size_t lag,
+               double *out) {
+  size_t t = lag;
+  const __m512d c0 = _mm512_set1_pd(c[0]);
+  for (; t + 8 <= n; t += 8) {
+    __m512d acc = c0;
+    for (size_t j = 0; j <= lag; ++j) {
+      const __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(voi + t - j));
+      acc = _mm512_fmadd_pd(_mm512_set1_pd(c[j + 1]), _mm512_cvtepi32_pd(v),
+                            acc);
+    }
+    _mm512_storeu_pd(out + t, acc);
+  }
+  return t;
+}
+
+PredictFn select_kernel() {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return predict_avx512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return predict_avx2;
+  }
+  return nullptr;
+}
+} // namespace
+
+void SignalEvaluator::predict(std::span<const int32_t> voi,
+                              std::span<const double> coefficients,
+                              std::span<double> out) {
+  if (coefficients.size() < 2) {
+    throw std::runtime_error("signal needs an intercept and one lag");
+  }
+  const size_t n = std::min(voi.size(), out.size());
+  const size_t lag = coefficients.size() - 2;
+  std::fill(out.begin(), out.begin() + std::min(lag, n), 0.0);
+  if (n <= lag) {
+    return;
+  }
+
+  static const PredictFn kernel = select_kernel();
+  const size_t done =
+      kernel ? kernel(voi.data(), n, coefficients.data(), lag, out.data())
+             : lag;
+  predict_scalar(voi.data(), done, n, coefficients.data(), lag, out.data());
+}
+
+SignalResult SignalEvaluator::simulate(std::span<const double> predictions,
+                                       std::span<const int32_t> bid,
+                                       std::span<const int32_t> ask,
+                                       const SignalParams &params) {
+  if (!(params.threshold_ > 0.0)) {
+    throw std::runtime_error("signal threshold must be positive");
+  }
+  SignalResult result;
+  const size_t n = std::min({predictions.size(), bid.size(), ask.size()});
+  if (n == 0) {
+    return result;
+  }
+  // predict() leaves 0 on the rows before the first full lag window
+  const size_t warmup = params.coefficients_.size() >= 2
+                            ? params.coefficients_.size() - 2
+                            : 0;
+
+  int position = 0;
+  int64_t buy_px = 0;
+  int64_t sell_px = 0;
+  const double thr = params.threshold_;
+  const int max_pos = params.max_position_;
+
+  for (size_t t = warmup; t < n; ++t) {
+    const double p = predictions[t];
+    if (p >= thr && position < max_pos) {
+      ++position;
+      buy_px += ask[t];
+      result.trades_.push_back({static_cast<uint32_t>(t), true, ask[t]});
+    } else if (p <= -thr && position > -max_pos) {
+      --position;
+      sell_px += bid[t];
+      result.trades_.push_back({static_cast<uint32_t>(t), false, bid[t]});
+    }
+  }
+
+  const auto last = static_cast<uint32_t>(n - 1);
+  for (; position > 0; --position) {
+    sell_px += bid[last];
+    result.trades_.push_back({last, false, bid[last]});
+  }
+  for (; position < 0; ++position) {
+    buy_px += ask[last];
+    result.trades_.push_back({last, true, ask[last]});
+  }
+
+  result.fees_ =
+      static_cast<int64_t>(result.trades_.size()) * params.fees_per_side_;
+  result.pnl_ = params.point_value_ * (sell_px - buy_px) - result.fees_;
+  return result;
+}
+
+SignalResult SignalEvaluator::evaluate(const FeatureFrame &frame,
+                                       const SignalParams &params) {
+  std::vector<double> predictions(frame.rows());
+  predict(frame.voi(), params.coefficients_, predictions);
+  return simulate(predictions, frame.bid(), frame.ask(), params);
+}
+
+std::vector<SignalResult>
+SignalEvaluator::evaluate_grid(const FeatureFrame &frame,
+                               std::span<const SignalParams> grid,
+                               unsigned threads) {
+  std::vector<SignalResult> results(grid.size());
+  if (grid.empty()) {
+    return results;
+  }
+
+  auto run = [&](size_t begin, size_t end) {
+    std::vector<double> predictions(frame.rows());
+    const std::vector<double> *current = nullptr;
+    for (size_t i = begin; i < end; ++i) {
+      const SignalParams &params = grid[i];
+      if (!current || *current != params.coefficients_) {
+        predict(frame.voi(), params.coefficients_, predictions);
+        current = &params.coefficients_;
+      }
+      results[i] = simulate(predictions, frame.bid(), frame.ask(), params);
+    }
+  };
+
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const size_t workers = std::min<size_t>(threads, grid.size());
+  if (workers == 1) {
+    run(0, grid.size());
+    return results;
+  }
+
+  std::vector<std::future<void>> futures;
+  const size_t chunk = (grid.size() + workers - 1) / workers;
+  for (size_t begin = 0; begin < grid.size(); begin += chunk) {
+    futures.emplace_back(std::async(std::launch::async, run, begin,
+                                    std::min(begin + chunk, grid.size())));
+  }
+  for (auto &f : futures) {
+    f.get();
+  }
+  return results;
+}
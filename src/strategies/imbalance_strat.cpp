@@ -5,10 +5,9 @@ private:
   double imbalance_mean_ = 0.0;
   double imbalance_variance_ = 0.0;
   int update_count_ = 0;
-  const int WARMUP_PERIOD = 1000;
 
 protected:
-  void fit_model() override {}
+  void fit_model(const FeatureFrame &) override {}
 
   void update_theo_values() override {
     if (position_ == 0) {
@@ -29,13 +28,19 @@ protected:
   }
 
 public:
-  explicit ImbalanceStrat(std::shared_ptr<ConnectionPool> pool,
+  explicit ImbalanceStrat(const LogConfig &logging,
                           const std::string &instrument_id, Orderbook *book)
-      : Strategy(pool, "imbalance_strat_log.csv", instrument_id, book) {
+      : Strategy(logging, "imbalance_strat_log.csv", instrument_id, book) {
     name_ = "imbalance_strat";
     req_fitting_ = false;
   }
 
+  std::string params() const override {
+    return "vol_levels=40;max_pos=" + std::to_string(max_pos_) +
+           ";fees=" + std::to_string(FEES_PER_SIDE_);
+  }
+  uint32_t version() const override { return 1; }
+
   void on_book_update() override {
     book_->calculate_vols(40);
     book_->calculate_imbalance();
@@ -63,28 +68,26 @@ public:
     calculate_pnl();
   }
 
-  void log_stats(const Orderbook &book) override {
-    std::string timestamp = book.get_formatted_time_fast();
+  void log_stats(const Orderbook &) override {
     const auto bid = book_->get_best_bid_price();
     const auto ask = book_->get_best_ask_price();
     int trade_count = buy_qty_ + sell_qty_;
 
-    logger_->log(timestamp, bid, ask, position_, trade_count, pnl_);
+    logger_->log(now_ns(), bid, ask, position_, trade_count, pnl_);
   }
 
   void execute_trade(bool is_buy, int32_t price, int32_t trade_size) override {
     if (is_buy) {
-      trade_queue_.emplace(true, price);
       position_ += 1;
       buy_qty_ += 1;
       real_total_buy_px_ += price * 1;
     } else {
-      trade_queue_.emplace(false, price);
       position_ -= 1;
       sell_qty_ += 1;
       real_total_sell_px_ += price * 1;
     }
     fees_ += FEES_PER_SIDE_;
+    record_fill(is_buy, price, 1);
   }
 
   void reset() override {
@@ -121,8 +124,7 @@ public:
       }
 
       if (initial_position != 0) {
-        std::string timestamp = book_->get_formatted_time_fast();
-        logger_->log(timestamp, book_->get_best_bid_price(),
+        logger_->log(now_ns(), book_->get_best_bid_price(),
                      book_->get_best_ask_price(), position_,
                      buy_qty_ + sell_qty_, pnl_);
       }
@@ -1,6 +1,8 @@
 #include "../../include/async_logger.h"
 #include "../../include/strategy.h"
 #include "../../include/book/orderbook.h"
+#include "../../include/regression_grid.h"
+#include "../../include/rls_estimator.h"
 #include <Eigen/Dense>
 #include <array>
 #include <chrono>
@@ -8,6 +10,7 @@
 #include <iostream>
 #include <memory>
 #include <numeric>
+#include <span>
 #include <queue>
 #include <vector>
 
@@ -22,11 +25,71 @@ protected:
 
   std::vector<double> model_coefficients_;
   int forecast_window_;
-  double fees_ = 0.0;
+
+  // online mode keeps refitting during the backtest. the target of the row
+  // ending at sample t is only known forecast_window_ samples later, so each
+  // sample updates the row that just matured
+  using Rls = RlsEstimator<MAX_LAG_ + 2>;
+  bool online_;
+  Rls rls_;
+  int64_t mid_window_sum_ = 0;
+
+  // voi and mid of every bar so far. mapped from the feature store when the
+  // backtester attached the day's columns, else computed from the book
+  FeatureFrame features_;
+  size_t bar_ = 0;
+  std::span<const int32_t> voi_series_;
+  std::span<const int32_t> mid_series_;
+
+  // false once a replay runs past the bars of the attached frame
+  bool update_series() {
+    if (features_.rows() > 0) {
+      if (bar_ >= features_.rows()) {
+        return false;
+      }
+      voi_series_ = features_.voi().first(bar_ + 1);
+      mid_series_ = features_.mid().first(bar_ + 1);
+    } else {
+      book_->calculate_voi_curr();
+      book_->add_mid_price_curr();
+      voi_series_ = book_->voi_history_curr_;
+      mid_series_ = book_->mid_prices_curr_;
+    }
+    ++bar_;
+    return true;
+  }
+
+  void update_online_model() {
+    const auto voi = voi_series_;
+    const auto mid = mid_series_;
+    const int t = static_cast<int>(mid.size()) - 1;
+
+    mid_window_sum_ += mid[t];
+    if (t >= forecast_window_) {
+      mid_window_sum_ -= mid[t - forecast_window_];
+    }
+
+    const int r = t - forecast_window_;
+    if (r < MAX_LAG_) {
+      return;
+    }
+
+    Rls::Vector x;
+    x(0) = 1.0;
+    for (int j = 0; j <= MAX_LAG_; ++j) {
+      x(j + 1) = static_cast<double>(voi[r - j]);
+    }
+    const double y = static_cast<double>(mid_window_sum_) / forecast_window_ -
+                     static_cast<double>(mid[r]);
+
+    rls_.update(x, y);
+    const auto &w = rls_.coefficients();
+    std::copy(w.data(), w.data() + w.size(), model_coefficients_.begin());
+  }
 
   [[nodiscard]] double predict_price_change() const {
 
-    size_t data_size = static_cast<int>(book_->voi_history_curr_.size());
+    size_t data_size = voi_series_.size();
 
     if (data_size < MAX_LAG_ + 1) {
       return 0.0;
@@ -36,7 +99,7 @@ protected:
 
     for (int i = 0; i <= MAX_LAG_; ++i) {
       size_t index = data_size - 1 - i;
-      auto voi = static_cast<double>(book_->voi_history_curr_[index]);
+      auto voi = static_cast<double>(voi_series_[index]);
       prediction += model_coefficients_[i + 1] * voi;
     }
 
@@ -69,13 +132,14 @@ protected:
   }
 
 public:
-  explicit LinearModelStrategy(std::shared_ptr<ConnectionPool> pool,
+  explicit LinearModelStrategy(const LogConfig &logging,
                                const std::string &instrument_id,
-                               Orderbook *book)
-      : Strategy(pool, "linear_model_strategy_log.csv", instrument_id, book),
-        forecast_window_(FORECAST_WINDOW_), fees_(0.0) {
+                               Orderbook *book, bool online = false)
+      : Strategy(logging, "linear_model_strategy_log.csv", instrument_id,
+                 book),
+        forecast_window_(FORECAST_WINDOW_), online_(online) {
     model_coefficients_.resize(MAX_LAG_ + 2, 0.0);
-    name_ = "linear_model_strat";
+    name_ = online_ ? "linear_model_online_strat" : "linear_model_strat";
     req_fitting_ = true;
     if (instrument_id == "es") {
       POINT_VALUE_ = 5;
@@ -86,36 +150,55 @@ public:
     }
   }
 
+  std::string params() const override {
+    return "max_lag=" + std::to_string(MAX_LAG_) +
+           ";window=" + std::to_string(forecast_window_) +
+           ";threshold=" + std::to_string(THRESHOLD_) +
+           ";point_value=" + std::to_string(POINT_VALUE_) +
+           ";max_pos=" + std::to_string(max_pos_) +
+           ";fees=" + std::to_string(FEES_PER_SIDE_);
+  }
+  uint32_t version() const override { return 1; }
+
   void execute_trade(bool is_buy, int32_t price, int32_t trade_size) override {
     if (is_buy) {
-      trade_queue_.emplace(true, price);
       position_ += TRADE_SIZE_;
       buy_qty_ += TRADE_SIZE_;
       real_total_buy_px_ += price * TRADE_SIZE_;
     } else {
-      trade_queue_.emplace(false, price);
       position_ -= TRADE_SIZE_;
       sell_qty_ += TRADE_SIZE_;
       real_total_sell_px_ += price * TRADE_SIZE_;
     }
     fees_ += FEES_PER_SIDE_;
+    record_fill(is_buy, price, TRADE_SIZE_);
   }
 
-  void log_stats(const Orderbook &book) override {
-    std::string timestamp = book.get_formatted_time_fast();
+  void log_stats(const Orderbook &) override {
     const int32_t bid = book_->get_best_bid_price();
     const int32_t ask = book_->get_best_ask_price();
     int trade_count = buy_qty_ + sell_qty_;
 
-    logger_->log(timestamp, bid, ask, position_, trade_count, pnl_);
+    logger_->log(now_ns(), bid, ask, position_, trade_count, pnl_);
+  }
+
+  uint32_t feature_columns() const override {
+    return feature_bit(Feature::VOI) | feature_bit(Feature::MID);
+  }
+
+  void attach_features(FeatureFrame frame) override {
+    features_ = std::move(frame);
   }
 
   void on_book_update() override {
 
-    book_->calculate_voi_curr();
-    book_->add_mid_price_curr();
+    const bool new_bar = update_series();
+
+    if (online_ && new_bar) {
+      update_online_model();
+    }
 
-    double predicted_change = predict_price_change();
+    double predicted_change = new_bar ? predict_price_change() : 0.0;
 
     int32_t bid_price = book_->get_best_bid_price();
     int32_t ask_price = book_->get_best_ask_price();
@@ -140,42 +223,31 @@ public:
     Strategy::reset();
     model_coefficients_.clear();
     model_coefficients_.resize(MAX_LAG_ + 2, 0.0);
-    position_ = 0;
-    pnl_ = 0.0;
-    fees_ = 0.0;
-    prev_pnl_ = 0.0;
+    rls_.reset();
+    mid_window_sum_ = 0;
+    features_ = {};
+    bar_ = 0;
+    voi_series_ = {};
+    mid_series_ = {};
   }
 
-  void fit_model() override {
+  void fit_model(const FeatureFrame &train) override {
     std::lock_guard<std::mutex> lock(fit_mutex_);
-    int n = static_cast<int>(book_->voi_history_.size()) - forecast_window_ -
-            MAX_LAG_;
-
-    Eigen::MatrixXd X(n, MAX_LAG_ + 2);
-    Eigen::VectorXd y(n);
-
-    for (int i = 0; i < n; ++i) {
-      X(i, 0) = 1.0;
-
-      for (int j = 0; j <= MAX_LAG_; ++j) {
-        double voi = static_cast<double>(book_->voi_history_[i + j]);
-        X(i, j + 1) = voi;
-      }
-
-      double avg_mid_change = 0.0;
-      for (int k = 1; k <= forecast_window_; ++k) {
-        avg_mid_change +=
-            static_cast<double>(book_->mid_prices_[i + MAX_LAG_ + k] -
-                                book_->mid_prices_[i + MAX_LAG_]);
-      }
-      avg_mid_change /= forecast_window_;
-      y(i) = avg_mid_change;
+    RegressionGrid grid(MAX_LAG_, {forecast_window_});
+    const GridStats stats = grid.accumulate(train.voi(), train.mid());
+    if (stats.rows_ <= MAX_LAG_ + 2) {
+      // nothing to fit; an online model starts cold
+      return;
     }
 
-    Eigen::VectorXd coeffs = X.colPivHouseholderQr().solve(y);
+    const GridFit fit = grid.solve(stats, MAX_LAG_, 0);
+    model_coefficients_ = fit.coefficients_;
 
-    model_coefficients_ =
-        std::vector<double>(coeffs.data(), coeffs.data() + coeffs.size());
+    if (online_) {
+      rls_.warm_start(
+          Rls::Vector(Eigen::Map<const Rls::Vector>(fit.coefficients_.data())),
+          stats.gram_);
+    }
 
     {
       std::lock_guard<std::mutex> log_lock(log_mutex_);
@@ -214,8 +286,7 @@ public:
       }
 
       if (initial_position != 0) {
-        std::string timestamp = book_->get_formatted_time_fast();
-        logger_->log(timestamp, book_->get_best_bid_price(),
+        logger_->log(now_ns(), book_->get_best_bid_price(),
                      book_->get_best_ask_price(), position_,
                      buy_qty_ + sell_qty_, pnl_);
       }
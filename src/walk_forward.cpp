@@ -0,0 +1,119 @@
+#include "../include/walk_forward.h"
+#include "../include/backtester.h"
+#include <deque>
+#include <future>
+#include <stdexcept>
+
+WalkForward::WalkForward(WalkForwardConfig config, Loader loader,
+                         std::shared_ptr<const FeatureStore> store)
+    : config_(std::move(config)), loader_(std::move(loader)),
+      store_(std::move(store)),
+      spec_(FeatureSpec::time_bars(
+          config_.bar_interval_ns_,
+          feature_bit(Feature::VOI) | feature_bit(Feature::MID) |
+              feature_bit(Feature::BID) | feature_bit(Feature::ASK))),
+      grid_(config_.max_lag_, {config_.horizon_}) {
+  if (config_.train_days_ == 0) {
+    throw std::runtime_error("walk forward needs at least one training day");
+  }
+  if (!loader_) {
+    throw std::runtime_error("walk forward needs a day loader");
+  }
+}
+
+WalkForward::PreparedDay WalkForward::prepare(size_t day) {
+  const std::string &file = config_.files_[day];
+  const std::shared_ptr<const MessageStore> store = loader_(file);
+  const auto messages = store->messages();
+
+  uint64_t start_ns = 0;
+  uint64_t end_ns = UINT64_MAX;
+  Backtester::session_window(file, start_ns, end_ns);
+
+  if (scratch_) {
+    scratch_->clear();
+  } else {
+    scratch_ = std::make_unique<Orderbook>(100, 7000000);
+  }
+  PreparedDay prepared;
+  prepared.frame_ =
+      store_ ? store_->load_or_extract(store->hash(), messages, start_ns,
+                                       end_ns, spec_, *scratch_)
+             : FeatureStore().extract(messages, start_ns, end_ns, spec_,
+                                      *scratch_);
+  prepared.stats_ =
+      grid_.accumulate(prepared.frame_.voi(), prepared.frame_.mid());
+  return prepared;
+}
+
+GridFit WalkForward::fit_window(const std::vector<GridStats> &window) const {
+  // days are separate sessions, so summing per-day stats is exact: no
+  // regression row spans a day boundary
+  GridStats total = grid_.empty_stats();
+  for (const auto &stats : window) {
+    total += stats;
+  }
+  return grid_.solve(total, config_.max_lag_, 0);
+}
+
+std::vector<WalkForwardDay> WalkForward::run() {
+  const size_t days = config_.files_.size();
+  const size_t k = config_.train_days_;
+  std::vector<WalkForwardDay> out;
+  if (days <= k) {
+    return out;
+  }
+  out.reserve(days - k);
+
+  auto prepare_async = [this](size_t day) {
+    return std::async(std::launch::async, &WalkForward::prepare, this, day);
+  };
+  auto fit_async = [this](std::vector<GridStats> window) {
+    return std::async(std::launch::async,
+                      [this, window = std::move(window)] {
+                        return fit_window(window);
+                      });
+  };
+
+  // warm up the first window, always extracting one day ahead
+  std::deque<GridStats> window;
+  std::future<PreparedDay> pending = prepare_async(0);
+  for (size_t day = 0; day < k; ++day) {
+    PreparedDay prepared = pending.get();
+    pending = prepare_async(day + 1);
+    window.push_back(std::move(prepared.stats_));
+  }
+  std::future<GridFit> fit =
+      fit_async(std::vector<GridStats>(window.begin(), window.end()));
+
+  for (size_t day = k; day < days; ++day) {
+    PreparedDay today = pending.get();
+    if (day + 1 < days) {
+      pending = prepare_async(day + 1);
+    }
+
+    WalkForwardDay result;
+    result.file_ = config_.files_[day];
+    result.fit_ = fit.get();
+    result.test_rows_ = today.frame_.rows();
+
+    // today's stats complete the window for tomorrow's model, which fits
+    // while today is evaluated
+    window.pop_front();
+    window.push_back(std::move(today.stats_));
+    if (day + 1 < days) {
+      fit = fit_async(std::vector<GridStats>(window.begin(), window.end()));
+    }
+
+    std::vector<SignalParams> params;
+    params.reserve(config_.thresholds_.size());
+    for (double threshold : config_.thresholds_) {
+      params.push_back({result.fit_.coefficients_, threshold,
+                        config_.max_position_, config_.point_value_,
+                        config_.fees_per_side_});
+    }
+    result.results_ = SignalEvaluator::evaluate_grid(today.frame_, params);
+    out.push_back(std::move(result));
+  }
+  return out;
+}